@@ -0,0 +1,182 @@
+/**
+ * @brief Micro-benchmark: JsonWriter vs nlohmann::json DOM + dump() for chat/completions payloads
+ * @brief 微基准测试：JsonWriter 对比 nlohmann::json DOM + dump() 生成 chat/completions 请求体
+ *
+ * Builds the payload of a request carrying a 10-round context (system prompt, 10 user/assistant
+ * pairs, the new line) both ways, exactly as TranslationServer::requestCompletion does now and
+ * did before, and prints the time and the heap allocations per payload.
+ * 以两种方式构建携带 10 轮上下文 (系统提示词、10 组用户/助手消息、新的一行) 的请求体，
+ * 分别对应 TranslationServer::requestCompletion 当前与之前的写法，输出每个请求体的耗时与堆分配次数。
+ *
+ * Allocations are counted through the global operator new. Qt containers allocate with malloc
+ * and are not counted; both paths end with one QByteArray for the body, and the DOM path also
+ * goes through one QString::toUtf8() per string, so its count is a lower bound.
+ * 分配次数通过全局 operator new 统计。Qt 容器使用 malloc 分配，不在统计之内；两条路径最后都
+ * 生成一个 QByteArray 请求体，而 DOM 路径还会对每个字符串调用一次 QString::toUtf8()，
+ * 因此其统计值是下限。
+ *
+ * Usage / 用法: bench_jsonwriter [iterations]
+ */
+#include "JsonWriter.h"
+#include "json.hpp"
+#include <QByteArray>
+#include <QString>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace {
+
+std::atomic<long long> g_allocCount{0};
+std::atomic<long long> g_allocBytes{0};
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    g_allocBytes.fetch_add(static_cast<long long>(size), std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+using json = nlohmann::json;
+
+constexpr int CONTEXT_ROUNDS = 10;
+constexpr int DEFAULT_ITERATIONS = 20000;
+
+// Same shape as TranslationServer::ChatMessage / 与 TranslationServer::ChatMessage 结构相同
+struct ChatMessage {
+    const char* role;
+    QString content;
+};
+
+struct Request {
+    QString model = QStringLiteral("deepseek-chat");
+    double temperature = 0.7;
+    std::vector<ChatMessage> messages;
+};
+
+Request makeRequest() {
+    Request r;
+    QString systemPrompt = QStringLiteral(
+        "你是一个游戏翻译引擎。将用户提供的日文文本翻译为简体中文，保留所有标签与换行符 \\n。"
+        "You are a game localization engine. Keep \"tags\" like <color=#ff0000> intact.\n");
+    systemPrompt = systemPrompt.repeated(6); // Glossary and rules make prompts long / 术语表与规则让提示词较长
+    r.messages.push_back({"system", systemPrompt});
+    for (int i = 0; i < CONTEXT_ROUNDS; ++i) {
+        r.messages.push_back({"user", QStringLiteral("「勇者よ、北の城へ向かうのだ！」\n魔王の封印が解けつつある…… (%1)").arg(i)});
+        r.messages.push_back({"assistant", QStringLiteral("“勇者啊，前往北方的城堡吧！”\n魔王的封印正在解除…… (%1)").arg(i)});
+    }
+    r.messages.push_back({"user", QStringLiteral("<tl>宝箱を開けた。\t[ポーション]を手に入れた！</tl>")});
+    return r;
+}
+
+// The old path: QString -> std::string -> DOM -> dump() -> QByteArray / 旧路径
+QByteArray buildWithDom(const Request& r) {
+    json messages = json::array();
+    for (const ChatMessage& message : r.messages) {
+        messages.push_back({{"role", message.role}, {"content", message.content.toStdString()}});
+    }
+    json payload;
+    payload["model"] = r.model.toStdString();
+    payload["messages"] = messages;
+    payload["temperature"] = r.temperature;
+    payload["stream"] = true;
+    payload["stream_options"] = {{"include_usage", true}};
+    return QByteArray::fromStdString(payload.dump());
+}
+
+// The current path, as in TranslationServer::requestCompletion / 当前路径
+QByteArray buildWithWriter(const Request& r) {
+    JsonWriter& payload = JsonWriter::forThread();
+    payload.beginObject();
+    payload.key("model");
+    payload.value(r.model);
+    payload.key("messages");
+    payload.beginArray();
+    for (const ChatMessage& message : r.messages) {
+        payload.beginObject();
+        payload.key("role");
+        payload.value(message.role);
+        payload.key("content");
+        payload.value(message.content);
+        payload.endObject();
+    }
+    payload.endArray();
+    payload.key("temperature");
+    payload.value(r.temperature);
+    payload.key("stream");
+    payload.value(true);
+    payload.key("stream_options");
+    payload.beginObject();
+    payload.key("include_usage");
+    payload.value(true);
+    payload.endObject();
+    payload.endObject();
+    return payload.toByteArray();
+}
+
+struct Result {
+    double nsPerPayload;
+    double allocsPerPayload;
+    double bytesPerPayload;
+    long long checksum; // Keeps the work from being optimized away / 防止被优化掉
+};
+
+Result run(const Request& r, int iterations, QByteArray (*build)(const Request&)) {
+    build(r); // Warm-up (the writer keeps its buffer) / 预热 (写入器会保留缓冲区)
+    const long long allocs0 = g_allocCount.load();
+    const long long bytes0 = g_allocBytes.load();
+    long long checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        checksum += build(r).size();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return {std::chrono::duration<double, std::nano>(elapsed).count() / iterations,
+            double(g_allocCount.load() - allocs0) / iterations,
+            double(g_allocBytes.load() - bytes0) / iterations,
+            checksum};
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : DEFAULT_ITERATIONS;
+    const Request request = makeRequest();
+
+    // Both paths must describe the same document / 两条路径必须生成相同的文档
+    const QByteArray domBody = buildWithDom(request);
+    const QByteArray writerBody = buildWithWriter(request);
+    if (json::parse(domBody.toStdString()) != json::parse(writerBody.toStdString())) {
+        std::printf("MISMATCH: the two payloads differ\n");
+        return 1;
+    }
+
+    std::printf("payload: %d messages, %lld bytes, iterations: %d\n",
+                int(request.messages.size()), static_cast<long long>(writerBody.size()), iterations);
+    std::printf("%-12s %12s %14s %16s\n", "path", "us/payload", "allocs/payload", "alloc bytes/payload");
+
+    const std::pair<const char*, QByteArray (*)(const Request&)> paths[] = {
+        {"nlohmann", &buildWithDom},
+        {"JsonWriter", &buildWithWriter},
+    };
+    long long checksum = 0;
+    for (const auto& [name, build] : paths) {
+        Result res = run(request, iterations, build);
+        checksum += res.checksum;
+        std::printf("%-12s %12.2f %14.1f %16.0f\n", name, res.nsPerPayload / 1000.0,
+                    res.allocsPerPayload, res.bytesPerPayload);
+    }
+    return checksum > 0 ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+/**
+ * @brief Micro-benchmark: SimdSearch::indexOf vs QString::contains(..., Qt::CaseInsensitive)
+ * @brief 微基准测试：SimdSearch::indexOf 对比 QString::contains(..., Qt::CaseInsensitive)
+ *
+ * Searches a set of glossary-like needles in game-line-sized haystacks, once in Latin and once
+ * in CJK text, and prints the average time per search. The match counts of both are compared,
+ * so the benchmark also fails (exit code 1) if the kernel disagrees with Qt.
+ * 在游戏文本行大小的字符串中查找一组类似术语表词条的模式串，分别针对拉丁文字和中日韩文字，
+ * 输出每次查找的平均耗时。两者的命中数会互相比对，若内核结果与 Qt 不一致则返回 1。
+ *
+ * Usage / 用法: bench_simdsearch [rounds]
+ */
+#include "SimdSearch.h"
+#include <QString>
+#include <QStringList>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <random>
+
+namespace {
+
+constexpr int LINE_COUNT = 2000;   // Haystacks per script / 每种文字的行数
+constexpr int LINE_LENGTH = 120;   // Characters per line / 每行字符数
+constexpr int NEEDLE_COUNT = 64;   // Needles per script / 每种文字的模式串数
+constexpr int DEFAULT_ROUNDS = 5;
+
+struct Corpus {
+    const char* name;
+    QStringList lines;
+    QStringList needles;
+};
+
+// Latin words in mixed case, so case folding is exercised / 大小写混合的拉丁单词，用于覆盖大小写折叠
+Corpus makeLatin(std::mt19937& rng) {
+    static const char* words[] = {
+        "the", "Sword", "of", "DAWN", "Village", "elder", "Potion", "quest", "Dragon", "gold",
+        "Merchant", "you", "have", "found", "a", "Key", "Castle", "north", "Guild", "level"
+    };
+    std::uniform_int_distribution<int> pick(0, int(std::size(words)) - 1);
+    Corpus c{"latin", {}, {}};
+    for (int i = 0; i < LINE_COUNT; ++i) {
+        QString line;
+        while (line.size() < LINE_LENGTH) {
+            line += QString::fromLatin1(words[pick(rng)]);
+            line += QChar(' ');
+        }
+        c.lines << line.left(LINE_LENGTH);
+    }
+    for (int i = 0; i < NEEDLE_COUNT; ++i) {
+        QString needle = QString::fromLatin1(words[pick(rng)]) + QChar(' ') + QString::fromLatin1(words[pick(rng)]);
+        // Flip the case of every other needle / 每隔一个模式串翻转大小写
+        c.needles << (i % 2 ? needle.toUpper() : needle.toLower());
+    }
+    return c;
+}
+
+// Kana and common CJK ideographs / 假名与常用汉字
+Corpus makeCjk(std::mt19937& rng) {
+    std::uniform_int_distribution<int> kana(0x3041, 0x3093);
+    std::uniform_int_distribution<int> kanji(0x4E00, 0x4FFF);
+    std::uniform_int_distribution<int> coin(0, 2);
+    auto randomChar = [&]() { return QChar(char16_t(coin(rng) ? kana(rng) : kanji(rng))); };
+
+    Corpus c{"cjk", {}, {}};
+    for (int i = 0; i < LINE_COUNT; ++i) {
+        QString line;
+        for (int k = 0; k < LINE_LENGTH; ++k) line += randomChar();
+        c.lines << line;
+    }
+    std::uniform_int_distribution<int> lineIndex(0, LINE_COUNT - 1);
+    std::uniform_int_distribution<int> offset(0, LINE_LENGTH - 4);
+    for (int i = 0; i < NEEDLE_COUNT; ++i) {
+        // Half taken from the corpus (hits), half random (mostly misses) / 一半取自语料 (命中)，一半随机 (多为未命中)
+        if (i % 2) {
+            c.needles << c.lines[lineIndex(rng)].mid(offset(rng), 3);
+        } else {
+            QString needle;
+            for (int k = 0; k < 3; ++k) needle += randomChar();
+            c.needles << needle;
+        }
+    }
+    return c;
+}
+
+template <typename Search>
+double nsPerSearch(const Corpus& c, int rounds, long long& hits, Search search) {
+    hits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (const QString& needle : c.needles) {
+            for (const QString& line : c.lines) {
+                if (search(line, needle)) ++hits;
+            }
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    const double searches = double(rounds) * c.needles.size() * c.lines.size();
+    return std::chrono::duration<double, std::nano>(elapsed).count() / searches;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const int rounds = argc > 1 ? std::max(1, std::atoi(argv[1])) : DEFAULT_ROUNDS;
+    std::mt19937 rng(20240601); // Fixed seed for comparable runs / 固定种子，便于多次运行对比
+
+    std::printf("SimdSearch kernel: %s, rounds: %d\n", SimdSearch::kernelName(), rounds);
+    std::printf("%-6s %14s %14s %8s\n", "text", "qt ns/op", "simd ns/op", "speedup");
+
+    bool agree = true;
+    for (const Corpus& c : {makeLatin(rng), makeCjk(rng)}) {
+        long long qtHits = 0, simdHits = 0;
+        const double qtNs = nsPerSearch(c, rounds, qtHits, [](const QString& h, const QString& n) {
+            return h.contains(n, Qt::CaseInsensitive);
+        });
+        const double simdNs = nsPerSearch(c, rounds, simdHits, [](const QString& h, const QString& n) {
+            return SimdSearch::contains(h, n);
+        });
+        std::printf("%-6s %14.1f %14.1f %7.2fx\n", c.name, qtNs, simdNs, qtNs / simdNs);
+        if (qtHits != simdHits) {
+            std::printf("  MISMATCH: qt %lld hits, simd %lld hits\n", qtHits, simdHits);
+            agree = false;
+        }
+    }
+    return agree ? 0 : 1;
+}
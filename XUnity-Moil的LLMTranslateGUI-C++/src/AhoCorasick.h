@@ -0,0 +1,240 @@
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <QChar>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
+
+/**
+ * @brief Case-insensitive Aho-Corasick Multi-pattern Matcher
+ * @brief 不区分大小写的 Aho-Corasick 多模式匹配器
+ *
+ * Finds every occurrence of every pattern in one pass over the text, independent of the
+ * number of patterns. Matching is done on case-folded UTF-16 code units, the same way
+ * QString::contains(..., Qt::CaseInsensitive) compares.
+ * 只需扫描文本一遍即可找出所有模式的所有出现位置，耗时与模式数量无关。
+ * 匹配基于大小写折叠后的 UTF-16 码元，与 QString::contains(..., Qt::CaseInsensitive) 的比较方式一致。
+ *
+ * Patterns can be added one by one after the initial build (failure links are refreshed).
+ * 初次构建后仍可逐条添加模式 (会刷新失败链接)。
+ *
+ * Not internally locked: the owner guards it (readers may search concurrently).
+ * 内部无锁：由持有者负责加锁 (多个读线程可并发查找)。
+ */
+class AhoCorasick {
+public:
+    struct Match {
+        int id;     // Pattern id (index passed to build / returned by insert) / 模式编号
+        int start;  // Start position in the text / 在文本中的起始位置
+        int length; // Length of the pattern / 模式长度
+    };
+
+    // Pointer-free layout of one state, for writing the automaton to disk
+    // 单个状态的无指针布局，用于将自动机写入磁盘
+    struct FlatState {
+        quint32 edgeStart; // First edge in the edge array / 在边数组中的第一条边
+        quint32 edgeCount; // Edges of this state, sorted by char / 本状态的边数，按字符排序
+        qint32 fail;
+        qint32 depth;
+        qint32 output;
+        qint32 dictLink;
+    };
+    struct FlatEdge {
+        quint16 ch;        // Folded code unit / 折叠后的码元
+        quint16 reserved;
+        qint32 target;
+    };
+
+    AhoCorasick() { clear(); }
+
+    void clear() {
+        m_goto.clear();
+        m_children.assign(1, {});
+        m_fail.assign(1, 0);
+        m_depth.assign(1, 0);
+        m_output.assign(1, -1);
+        m_dictLink.assign(1, -1);
+        m_nextSame.clear();
+        m_patternCount = 0;
+    }
+
+    // Build from scratch; pattern i gets id i / 从头构建；第 i 个模式的编号为 i
+    void build(const QStringList& patterns) {
+        clear();
+        m_goto.reserve(size_t(patterns.size()) * 4);
+        for (const QString& p : patterns) addToTrie(p);
+        linkFailures();
+    }
+
+    // Add one pattern to a built automaton; returns its id / 向已构建的自动机添加一个模式，返回其编号
+    int insert(const QString& pattern) {
+        int id = addToTrie(pattern);
+        linkFailures();
+        return id;
+    }
+
+    int patternCount() const { return m_patternCount; }
+
+    // All matches in text (overlapping ones included), ordered by end position
+    // 文本中的所有匹配 (包括重叠的)，按结束位置排序
+    std::vector<Match> findAll(const QString& text) const {
+        return scan(*this, text);
+    }
+
+    // Export the automaton as flat arrays (see FlatAhoCorasick) / 将自动机导出为平坦数组 (见 FlatAhoCorasick)
+    void flatten(std::vector<FlatState>& states, std::vector<FlatEdge>& edges, std::vector<qint32>& nextSame) const {
+        states.clear();
+        edges.clear();
+        states.reserve(m_fail.size());
+        edges.reserve(m_goto.size());
+        for (size_t s = 0; s < m_fail.size(); ++s) {
+            std::vector<std::pair<char16_t, int>> children = m_children[s];
+            std::sort(children.begin(), children.end());
+            states.push_back({quint32(edges.size()), quint32(children.size()),
+                              m_fail[s], m_depth[s], m_output[s], m_dictLink[s]});
+            for (const auto& edge : children) edges.push_back({quint16(edge.first), 0, edge.second});
+        }
+        nextSame.assign(m_nextSame.begin(), m_nextSame.end());
+    }
+
+    // Shared search loop over any automaton exposing step/fail/output/dictLink/depth/nextSame
+    // 通用查找循环，适用于任何提供 step/fail/output/dictLink/depth/nextSame 的自动机
+    template <class Automaton>
+    static std::vector<Match> scan(const Automaton& a, const QString& text) {
+        std::vector<Match> matches;
+        int state = 0;
+        const int n = int(text.size());
+        for (int i = 0; i < n; ++i) {
+            char16_t c = fold(text.at(i));
+            int next;
+            while ((next = a.step(state, c)) < 0 && state != 0) state = a.fail(state);
+            state = next < 0 ? 0 : next;
+
+            // Walk this state and its dictionary suffix links / 遍历当前状态及其字典后缀链接
+            for (int s = a.output(state) >= 0 ? state : a.dictLink(state); s >= 0; s = a.dictLink(s)) {
+                for (int id = a.output(s); id >= 0; id = a.nextSame(id)) {
+                    matches.push_back({id, i - a.depth(s) + 1, a.depth(s)});
+                }
+            }
+        }
+        return matches;
+    }
+
+    static char16_t fold(QChar c) { return c.toCaseFolded().unicode(); }
+
+    int step(int state, char16_t c) const {
+        auto it = m_goto.find(edgeKey(state, c));
+        return it == m_goto.end() ? -1 : it->second;
+    }
+    int fail(int state) const { return m_fail[state]; }
+    int output(int state) const { return m_output[state]; }
+    int dictLink(int state) const { return m_dictLink[state]; }
+    int depth(int state) const { return m_depth[state]; }
+    int nextSame(int id) const { return m_nextSame[id]; }
+
+private:
+
+    static quint64 edgeKey(int state, char16_t c) { return (quint64(quint32(state)) << 16) | c; }
+
+    int addToTrie(const QString& pattern) {
+        int id = m_patternCount++;
+        m_nextSame.push_back(-1);
+        if (pattern.isEmpty()) return id; // Never matches / 永不匹配
+
+        int state = 0;
+        for (QChar ch : pattern) {
+            char16_t c = fold(ch);
+            int next = step(state, c);
+            if (next < 0) {
+                next = int(m_fail.size());
+                m_goto.emplace(edgeKey(state, c), next);
+                m_fail.push_back(0);
+                m_depth.push_back(m_depth[state] + 1);
+                m_output.push_back(-1);
+                m_dictLink.push_back(-1);
+                m_children.resize(m_fail.size());
+                m_children[state].push_back({c, next});
+            }
+            state = next;
+        }
+        // Patterns that fold to the same string share the state / 折叠后相同的模式共享同一状态
+        m_nextSame[id] = m_output[state];
+        m_output[state] = id;
+        return id;
+    }
+
+    // Breadth-first pass computing failure and dictionary links / 广度优先计算失败链接与字典链接
+    void linkFailures() {
+        m_children.resize(m_fail.size());
+        std::deque<int> queue;
+        for (const auto& edge : m_children[0]) {
+            m_fail[edge.second] = 0;
+            m_dictLink[edge.second] = -1;
+            queue.push_back(edge.second);
+        }
+        while (!queue.empty()) {
+            int state = queue.front();
+            queue.pop_front();
+            for (const auto& edge : m_children[state]) {
+                int child = edge.second;
+                int f = m_fail[state];
+                int next;
+                while ((next = step(f, edge.first)) < 0 && f != 0) f = m_fail[f];
+                m_fail[child] = next < 0 ? 0 : next;
+                int fc = m_fail[child];
+                m_dictLink[child] = m_output[fc] >= 0 ? fc : m_dictLink[fc];
+                queue.push_back(child);
+            }
+        }
+    }
+
+    std::unordered_map<quint64, int> m_goto;  // (state, folded char) -> state / (状态, 折叠字符) -> 状态
+    std::vector<std::vector<std::pair<char16_t, int>>> m_children; // Trie edges for the BFS / 供广度优先遍历的 trie 边
+    std::vector<int> m_fail;      // Failure link / 失败链接
+    std::vector<int> m_depth;     // Length of the string spelled by the state / 状态对应字符串的长度
+    std::vector<int> m_output;    // First pattern ending here, -1 if none / 在此结束的第一个模式，无则为 -1
+    std::vector<int> m_dictLink;  // Nearest proper suffix state with output / 最近的带输出的真后缀状态
+    std::vector<int> m_nextSame;  // Next pattern id sharing the same end state / 共享同一结束状态的下一个模式
+    int m_patternCount = 0;
+};
+
+/**
+ * @brief Read-only Aho-Corasick over flat arrays (e.g. a memory-mapped file)
+ * @brief 基于平坦数组 (如内存映射文件) 的只读 Aho-Corasick
+ *
+ * Does not own the arrays. Edges of a state are binary-searched instead of hashed.
+ * 不持有数组。每个状态的边使用二分查找而非哈希。
+ */
+class FlatAhoCorasick {
+public:
+    FlatAhoCorasick() = default;
+    FlatAhoCorasick(const AhoCorasick::FlatState* states, const AhoCorasick::FlatEdge* edges, const qint32* nextSame)
+        : m_states(states), m_edges(edges), m_nextSame(nextSame) {}
+
+    std::vector<AhoCorasick::Match> findAll(const QString& text) const {
+        if (!m_states) return {};
+        return AhoCorasick::scan(*this, text);
+    }
+
+    int step(int state, char16_t c) const {
+        const AhoCorasick::FlatState& s = m_states[state];
+        const AhoCorasick::FlatEdge* first = m_edges + s.edgeStart;
+        const AhoCorasick::FlatEdge* last = first + s.edgeCount;
+        const AhoCorasick::FlatEdge* it = std::lower_bound(first, last, c,
+            [](const AhoCorasick::FlatEdge& e, char16_t ch) { return e.ch < ch; });
+        return (it != last && it->ch == c) ? it->target : -1;
+    }
+    int fail(int state) const { return m_states[state].fail; }
+    int output(int state) const { return m_states[state].output; }
+    int dictLink(int state) const { return m_states[state].dictLink; }
+    int depth(int state) const { return m_states[state].depth; }
+    int nextSame(int id) const { return m_nextSame[id]; }
+
+private:
+    const AhoCorasick::FlatState* m_states = nullptr;
+    const AhoCorasick::FlatEdge* m_edges = nullptr;
+    const qint32* m_nextSame = nullptr;
+};
@@ -0,0 +1,276 @@
+#include "ApiKeyScheduler.h"
+#include <QDateTime>
+#include <QRegularExpression>
+#include <algorithm>
+#include <chrono>
+
+namespace {
+// Cool-down limits / 冷却时长上下限
+constexpr qint64 kMaxRateLimitCooldownMs = 60 * 1000;
+constexpr qint64 kMaxServerErrorCooldownMs = 30 * 1000;
+constexpr qint64 kNetworkErrorCooldownMs = 5 * 1000;
+constexpr qint64 kQuarantineMs = 10 * 60 * 1000;
+// Weight of the newest latency sample / 最新延迟样本的权重
+constexpr double kLatencyAlpha = 0.3;
+}
+
+void ApiKeyScheduler::setKeys(const QStringList& keys) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<KeyState> updated;
+    for (const QString& raw : keys) {
+        QString key = raw.trimmed();
+        if (key.isEmpty()) continue;
+        auto it = std::find_if(m_keys.begin(), m_keys.end(), [&key](const KeyState& s) { return s.key == key; });
+        if (it != m_keys.end()) {
+            updated.push_back(*it);
+        } else {
+            KeyState state;
+            state.key = key;
+            updated.push_back(state);
+        }
+    }
+    m_keys.swap(updated);
+    m_next = 0;
+}
+
+/**
+ * @brief Hands out the usable key with the most headroom
+ * @brief 分配余量最大的可用密钥
+ */
+QString ApiKeyScheduler::acquire(const QSet<QString>& excluded, qint64* waitMs) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (waitMs) *waitMs = -1;
+    if (m_keys.empty()) return "";
+
+    const qint64 now = nowMs();
+    qint64 soonest = -1;
+    int best = -1;
+    // First pass honours `excluded`, the second one accepts any usable key
+    // 第一轮遵守 `excluded`，第二轮接受任意可用密钥
+    for (int pass = 0; pass < 2 && best < 0; ++pass) {
+        double bestScore = 0;
+        for (size_t n = 0; n < m_keys.size(); ++n) {
+            size_t i = (m_next + n) % m_keys.size();
+            const KeyState& state = m_keys[i];
+            if (pass == 0 && excluded.contains(state.key)) continue;
+            if (state.quarantineUntil > now) continue;
+            if (state.cooldownUntil > now) {
+                qint64 wait = state.cooldownUntil - now;
+                if (soonest < 0 || wait < soonest) soonest = wait;
+                continue;
+            }
+            double s = score(state);
+            if (best < 0 || s < bestScore) {
+                best = int(i);
+                bestScore = s;
+            }
+        }
+    }
+
+    if (best < 0) {
+        if (waitMs) *waitMs = soonest;
+        return "";
+    }
+    m_next = (size_t(best) + 1) % m_keys.size();
+    ++m_keys[best].inFlight;
+    return m_keys[best].key;
+}
+
+/**
+ * @brief Updates the key's history and applies cool-down / quarantine
+ * @brief 更新密钥的历史记录，并施加冷却 / 隔离
+ */
+ApiKeyScheduler::KeyChange ApiKeyScheduler::release(const QString& key, Outcome outcome, qint64 latencyMs,
+                                                    const QList<QNetworkReply::RawHeaderPair>& headers) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = std::find_if(m_keys.begin(), m_keys.end(), [&key](const KeyState& s) { return s.key == key; });
+    if (it == m_keys.end()) return KeyChange::None; // Removed by a config update / 已被配置更新移除
+    KeyState& state = *it;
+    if (state.inFlight > 0) --state.inFlight;
+    if (outcome == Outcome::Cancelled) return KeyChange::None;
+
+    const qint64 now = nowMs();
+    ++state.requests;
+    state.latencyEwmaMs = state.latencyEwmaMs <= 0
+        ? double(latencyMs)
+        : kLatencyAlpha * double(latencyMs) + (1.0 - kLatencyAlpha) * state.latencyEwmaMs;
+
+    QByteArray remaining = header(headers, "x-ratelimit-remaining-requests");
+    if (!remaining.isEmpty()) {
+        bool ok = false;
+        int value = remaining.toInt(&ok);
+        if (ok) state.remainingRequests = value;
+    }
+    qint64 resetMs = parseDurationMs(header(headers, "x-ratelimit-reset-requests"));
+
+    switch (outcome) {
+    case Outcome::Success:
+        state.consecutiveFailures = 0;
+        // Quota exhausted: rest until the window resets / 配额耗尽：休息到窗口重置
+        if (state.remainingRequests == 0 && resetMs > 0) {
+            state.cooldownUntil = now + resetMs;
+            return KeyChange::CoolingDown;
+        }
+        return KeyChange::None;
+
+    case Outcome::RateLimited: {
+        ++state.rateLimited;
+        ++state.consecutiveFailures;
+        qint64 cooldown = retryAfterMs(headers);
+        if (cooldown < 0) cooldown = resetMs;
+        if (cooldown <= 0) {
+            // No hint from the server: 1s, 2s, 4s ... / 服务器未给出提示：1 秒、2 秒、4 秒……
+            cooldown = qint64(1000) << std::min(state.consecutiveFailures - 1, 6);
+        }
+        state.cooldownUntil = now + std::min(cooldown, kMaxRateLimitCooldownMs);
+        return KeyChange::CoolingDown;
+    }
+
+    case Outcome::ServerError: {
+        ++state.serverErrors;
+        ++state.consecutiveFailures;
+        qint64 cooldown = retryAfterMs(headers);
+        if (cooldown <= 0) cooldown = qint64(1000) << std::min(state.consecutiveFailures - 1, 5);
+        state.cooldownUntil = now + std::min(cooldown, kMaxServerErrorCooldownMs);
+        return KeyChange::CoolingDown;
+    }
+
+    case Outcome::AuthFailed:
+        ++state.authFailures;
+        state.quarantineUntil = now + kQuarantineMs;
+        return KeyChange::Quarantined;
+
+    case Outcome::NetworkError:
+        ++state.consecutiveFailures;
+        // Repeated failures on one key: give it a short break / 同一密钥连续失败：短暂休息
+        if (state.consecutiveFailures >= 3) {
+            state.cooldownUntil = now + kNetworkErrorCooldownMs;
+            return KeyChange::CoolingDown;
+        }
+        return KeyChange::None;
+
+    case Outcome::RequestError:
+        // The key answered fine; the same input would fail on any key / 密钥本身正常；同样的输入换任何密钥都会失败
+        return KeyChange::None;
+
+    case Outcome::Cancelled:
+        break;
+    }
+    return KeyChange::None;
+}
+
+qint64 ApiKeyScheduler::waitForKeyMs() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const qint64 now = nowMs();
+    qint64 soonest = -1;
+    for (const KeyState& state : m_keys) {
+        if (state.quarantineUntil > now) continue;
+        qint64 wait = std::max<qint64>(0, state.cooldownUntil - now);
+        if (soonest < 0 || wait < soonest) soonest = wait;
+    }
+    return soonest;
+}
+
+int ApiKeyScheduler::keyCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return int(m_keys.size());
+}
+
+std::vector<ApiKeyScheduler::KeyStats> ApiKeyScheduler::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const qint64 now = nowMs();
+    std::vector<KeyStats> result;
+    for (const KeyState& state : m_keys) {
+        KeyStats s;
+        s.label = maskKey(state.key);
+        s.inFlight = state.inFlight;
+        s.latencyMs = int(state.latencyEwmaMs);
+        s.requests = state.requests;
+        s.rateLimited = state.rateLimited;
+        s.serverErrors = state.serverErrors;
+        s.authFailures = state.authFailures;
+        s.coolingDown = state.cooldownUntil > now;
+        s.quarantined = state.quarantineUntil > now;
+        result.push_back(s);
+    }
+    return result;
+}
+
+ApiKeyScheduler::Outcome ApiKeyScheduler::classify(const UpstreamResponse& reply) {
+    if (reply.timedOut || reply.httpStatus == 408) return Outcome::NetworkError;
+    if (reply.httpStatus == 429) return Outcome::RateLimited;
+    if (reply.httpStatus == 401 || reply.httpStatus == 403) return Outcome::AuthFailed;
+    if (reply.httpStatus >= 500) return Outcome::ServerError;
+    if (reply.error == QNetworkReply::NoError) return Outcome::Success;
+    if (reply.error == QNetworkReply::OperationCanceledError) return Outcome::Cancelled;
+    // Content filter, unknown model, payload too large, context too long... / 内容过滤、模型不存在、请求过大、上下文过长等
+    if (reply.httpStatus >= 400) return Outcome::RequestError;
+    return Outcome::NetworkError;
+}
+
+QString ApiKeyScheduler::maskKey(const QString& key) {
+    if (key.size() <= 10) return QString(key.size(), '*');
+    return key.left(6) + "..." + key.right(4);
+}
+
+qint64 ApiKeyScheduler::retryAfterMs(const QList<QNetworkReply::RawHeaderPair>& headers) {
+    QByteArray value = header(headers, "retry-after").trimmed();
+    if (value.isEmpty()) return -1;
+    bool ok = false;
+    double seconds = value.toDouble(&ok);
+    if (ok) return qint64(std::max(0.0, seconds) * 1000);
+    // HTTP date form, e.g. "Wed, 21 Oct 2015 07:28:00 GMT" / HTTP 日期格式
+    QDateTime when = QDateTime::fromString(QString::fromLatin1(value), Qt::RFC2822Date);
+    if (!when.isValid()) return -1;
+    return std::max<qint64>(0, QDateTime::currentDateTimeUtc().msecsTo(when));
+}
+
+qint64 ApiKeyScheduler::nowMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Parses x-ratelimit-reset-* values such as "20ms", "1s", "6m0s" or "1.5"
+ * @brief 解析 x-ratelimit-reset-* 的值，如 "20ms"、"1s"、"6m0s" 或 "1.5"
+ */
+qint64 ApiKeyScheduler::parseDurationMs(const QByteArray& value) {
+    QString text = QString::fromLatin1(value.trimmed());
+    if (text.isEmpty()) return -1;
+    bool ok = false;
+    double seconds = text.toDouble(&ok);
+    if (ok) return qint64(seconds * 1000);
+
+    static const QRegularExpression part("(\\d+(?:\\.\\d+)?)(ms|h|m|s)");
+    double total = 0;
+    bool matched = false;
+    QRegularExpressionMatchIterator it = part.globalMatch(text);
+    while (it.hasNext()) {
+        QRegularExpressionMatch m = it.next();
+        double n = m.captured(1).toDouble();
+        QString unit = m.captured(2);
+        if (unit == "ms") total += n;
+        else if (unit == "s") total += n * 1000;
+        else if (unit == "m") total += n * 60 * 1000;
+        else total += n * 3600 * 1000;
+        matched = true;
+    }
+    return matched ? qint64(total) : -1;
+}
+
+QByteArray ApiKeyScheduler::header(const QList<QNetworkReply::RawHeaderPair>& headers, const char* name) {
+    for (const auto& pair : headers) {
+        if (pair.first.compare(name, Qt::CaseInsensitive) == 0) return pair.second;
+    }
+    return QByteArray();
+}
+
+double ApiKeyScheduler::score(const KeyState& state) {
+    // Expected wait if we add one more call: queue length x typical latency
+    // 再加一个请求时的预期等待：队列长度 x 典型延迟
+    double latency = state.latencyEwmaMs > 0 ? state.latencyEwmaMs : 1000.0;
+    double s = (state.inFlight + 1) * latency * (1 + state.consecutiveFailures);
+    // Nearly out of quota for this window / 本窗口配额即将用尽
+    if (state.remainingRequests >= 0 && state.remainingRequests <= state.inFlight) s *= 10;
+    return s;
+}
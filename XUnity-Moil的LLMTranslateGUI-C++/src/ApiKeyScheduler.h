@@ -0,0 +1,105 @@
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <QSet>
+#include <mutex>
+#include <vector>
+#include "UpstreamClient.h"
+
+/**
+ * @brief Rate-limit-aware API Key Scheduler
+ * @brief 感知限流的 API 密钥调度器
+ *
+ * Replaces blind round-robin. Every key tracks its in-flight count, a moving average
+ * of its latency, its recent 429/5xx history and the Retry-After / x-ratelimit-* headers
+ * it received. acquire() hands out the usable key with the most headroom; keys that were
+ * rate limited cool down, keys rejected with 401/403 are quarantined.
+ * 取代盲目的轮询。每个密钥记录进行中的请求数、延迟滑动平均、近期 429/5xx 记录，
+ * 以及收到的 Retry-After / x-ratelimit-* 头。acquire() 分配余量最大的可用密钥；
+ * 被限流的密钥进入冷却，被 401/403 拒绝的密钥被隔离。
+ */
+class ApiKeyScheduler {
+public:
+    // Result of one call made with a key / 使用某密钥的一次调用结果
+    enum class Outcome {
+        Success,      // HTTP 2xx (even if the body was unusable) / HTTP 2xx (即使响应内容不可用)
+        RateLimited,  // HTTP 429
+        ServerError,  // HTTP 5xx
+        AuthFailed,   // HTTP 401 / 403
+        NetworkError, // Timeout, connection failure (no HTTP status) / 超时、连接失败 (无 HTTP 状态码)
+        RequestError, // Other HTTP 4xx: the request itself was rejected, not the key / 其他 HTTP 4xx：被拒绝的是请求本身而非密钥
+        Cancelled     // Aborted because the server is stopping / 服务停止导致的中止
+    };
+
+    // What release() did to the key / release() 对密钥做出的处理
+    enum class KeyChange { None, CoolingDown, Quarantined };
+
+    struct KeyStats {
+        QString label;          // Masked key / 打码后的密钥
+        int inFlight = 0;
+        int latencyMs = 0;      // Moving average, 0 if unknown / 滑动平均，未知时为 0
+        quint64 requests = 0;
+        quint64 rateLimited = 0;
+        quint64 serverErrors = 0;
+        quint64 authFailures = 0;
+        bool coolingDown = false;
+        bool quarantined = false;
+    };
+
+    // Replace the key list; keys that stay keep their history / 替换密钥列表；保留的密钥沿用其历史记录
+    void setKeys(const QStringList& keys);
+
+    // Pick the usable key with the most headroom and count it as in flight. Keys in `excluded`
+    // are only used when nothing else is available. Returns "" when every key is cooling down
+    // or quarantined; `waitMs` then receives the time until the next key is usable (-1 if none will be).
+    // 选取余量最大的可用密钥并计入进行中。`excluded` 中的密钥仅在别无选择时使用。
+    // 所有密钥都在冷却或隔离时返回 ""，此时 `waitMs` 为距下一个密钥可用的时间 (永不可用时为 -1)。
+    QString acquire(const QSet<QString>& excluded = QSet<QString>(), qint64* waitMs = nullptr);
+
+    // Report the result of a call made with an acquired key / 报告使用已分配密钥的调用结果
+    KeyChange release(const QString& key, Outcome outcome, qint64 latencyMs,
+                      const QList<QNetworkReply::RawHeaderPair>& headers = {});
+
+    // 0 if a key is usable now, else time until the next one is (-1 if none will be)
+    // 当前有可用密钥时为 0，否则为距下一个密钥可用的时间 (永不可用时为 -1)
+    qint64 waitForKeyMs() const;
+
+    int keyCount() const;
+    std::vector<KeyStats> stats() const;
+
+    // Map an upstream response to a key outcome / 将上游响应映射为密钥调用结果
+    static Outcome classify(const UpstreamResponse& reply);
+
+    // "sk-abc...wxyz" style label for logs / 用于日志的 "sk-abc...wxyz" 形式标签
+    static QString maskKey(const QString& key);
+
+    // Delay requested by Retry-After (seconds or HTTP date), -1 if absent
+    // Retry-After 请求的等待时间 (秒数或 HTTP 日期)，不存在时为 -1
+    static qint64 retryAfterMs(const QList<QNetworkReply::RawHeaderPair>& headers);
+
+private:
+    struct KeyState {
+        QString key;
+        int inFlight = 0;
+        double latencyEwmaMs = 0;     // 0 = no sample yet / 0 表示尚无样本
+        int consecutiveFailures = 0;
+        int remainingRequests = -1;   // x-ratelimit-remaining-requests, -1 = unknown / -1 表示未知
+        qint64 cooldownUntil = 0;     // Steady-clock ms / 单调时钟毫秒
+        qint64 quarantineUntil = 0;
+        quint64 requests = 0;
+        quint64 rateLimited = 0;
+        quint64 serverErrors = 0;
+        quint64 authFailures = 0;
+    };
+
+    static qint64 nowMs();
+    static qint64 parseDurationMs(const QByteArray& value);
+    static QByteArray header(const QList<QNetworkReply::RawHeaderPair>& headers, const char* name);
+
+    // Lower is better / 越小越好
+    static double score(const KeyState& state);
+
+    std::vector<KeyState> m_keys;
+    size_t m_next = 0; // Rotating start so equal scores still spread / 轮换起点，分数相同时仍能分散
+    mutable std::mutex m_mutex;
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <QRegularExpression>
+#include <vector>
+
+/**
+ * @brief Numbered Multi-line Reply Parser
+ * @brief 编号多行回复解析器
+ *
+ * Batch mode sends several lines as "<n>. <text>" and asks for the translations in the same
+ * format. The reply is only accepted if it can be mapped back to every line without guessing.
+ * 批量模式以 "<n>. <文本>" 的格式发送多行文本，并要求以同样的格式返回译文。
+ * 只有回复能够不靠猜测地对应回每一行时才被接受。
+ */
+class BatchReply {
+public:
+    // Split reply into expected translations; succeeds only if every number 1..expected appears exactly once
+    // 将回复拆分为 expected 条译文；仅当编号 1..expected 每个都恰好出现一次时才算成功
+    static bool split(const QString& reply, int expected, QStringList& out) {
+        static const QRegularExpression reLine(R"(^\s*(\d+)\s*[.．、:：)）\]]\s*(.*)$)");
+        QStringList parsed;
+        std::vector<bool> seen(size_t(expected > 0 ? expected : 0), false);
+        for (int i = 0; i < expected; ++i) parsed << QString();
+        int filled = 0;
+        bool started = false;
+
+        const QStringList lines = reply.split('\n', Qt::SkipEmptyParts);
+        for (const QString& line : lines) {
+            QRegularExpressionMatch match = reLine.match(line);
+            if (!match.hasMatch()) {
+                // Ignore chatter before the list, but an unnumbered line inside it means the split is off
+                // 忽略列表前的多余说明，但列表中出现无编号行说明拆分已经错位
+                if (started && !line.trimmed().isEmpty()) return false;
+                continue;
+            }
+            started = true;
+            int n = match.captured(1).toInt();
+            if (n < 1 || n > expected || seen[size_t(n - 1)]) return false;
+            seen[size_t(n - 1)] = true;
+            parsed[n - 1] = match.captured(2).trimmed();
+            ++filled;
+        }
+        if (filled != expected) return false;
+
+        out = parsed;
+        return true;
+    }
+};
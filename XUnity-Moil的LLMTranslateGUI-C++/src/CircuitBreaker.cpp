@@ -0,0 +1,129 @@
+#include "CircuitBreaker.h"
+#include <chrono>
+
+void CircuitBreaker::configure(const Settings& settings) {
+    std::function<void(State)> listener;
+    bool changed = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_settings = settings;
+        m_window.clear();
+        m_probesInFlight = 0;
+        changed = transitionTo(State::Closed);
+        listener = m_listener;
+    }
+    if (changed && listener) listener(State::Closed);
+}
+
+void CircuitBreaker::setListener(std::function<void(State)> listener) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_listener = std::move(listener);
+}
+
+CircuitBreaker::Ticket CircuitBreaker::allowRequest() {
+    std::function<void(State)> listener;
+    bool changed = false;
+    Ticket ticket;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_settings.enabled) {
+            ticket.allowed = true;
+            return ticket;
+        }
+
+        switch (m_state) {
+        case State::Closed:
+            ticket.allowed = true;
+            break;
+        case State::Open:
+            // Cool-off over: let a probe through / 冷却结束：放行探测请求
+            if (nowMs() - m_openedAt < m_settings.openMs) break;
+            changed = transitionTo(State::HalfOpen);
+            [[fallthrough]];
+        case State::HalfOpen:
+            if (m_probesInFlight < m_settings.halfOpenProbes) {
+                ++m_probesInFlight;
+                ticket.allowed = true;
+            }
+            break;
+        }
+        ticket.generation = m_generation;
+        listener = m_listener;
+    }
+    if (changed && listener) listener(State::HalfOpen);
+    return ticket;
+}
+
+void CircuitBreaker::record(const Ticket& ticket, Result result, qint64 latencyMs) {
+    std::function<void(State)> listener;
+    bool changed = false;
+    State current;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_settings.enabled) return;
+        // Admitted in an earlier state period: says nothing about the current one
+        // (while half-open, a matching generation means the call is one of the probes)
+        // 在更早的状态周期中放行：与当前周期无关 (半开期间代数一致即说明该调用是探测请求)
+        if (!ticket.allowed || ticket.generation != m_generation) return;
+
+        if (m_state == State::HalfOpen) {
+            if (m_probesInFlight > 0) --m_probesInFlight;
+            // A probe decides: healthy closes, failing re-opens / 探测结果决定：健康则关闭，失败则重新打开
+            if (result == Result::Success) changed = transitionTo(State::Closed);
+            else if (result == Result::Failure) changed = transitionTo(State::Open);
+        } else if (result != Result::Ignored) {
+            Sample sample;
+            sample.failed = result == Result::Failure;
+            sample.slow = !sample.failed && latencyMs >= m_settings.slowCallMs;
+            m_window.push_back(sample);
+            while (int(m_window.size()) > m_settings.windowSize) m_window.pop_front();
+            if (m_state == State::Closed) changed = tripIfUnhealthy();
+        }
+        current = m_state;
+        listener = m_listener;
+    }
+    if (changed && listener) listener(current);
+}
+
+bool CircuitBreaker::isRejecting() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_settings.enabled && m_state == State::Open && nowMs() - m_openedAt < m_settings.openMs;
+}
+
+CircuitBreaker::State CircuitBreaker::state() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_state;
+}
+
+bool CircuitBreaker::transitionTo(State next) {
+    if (m_state == next) return false;
+    m_state = next;
+    ++m_generation;
+    if (next == State::Open) {
+        m_openedAt = nowMs();
+        m_probesInFlight = 0;
+    }
+    // Start every closed period with a clean window / 每次关闭都从干净的窗口开始
+    if (next == State::Closed) m_window.clear();
+    return true;
+}
+
+bool CircuitBreaker::tripIfUnhealthy() {
+    int total = int(m_window.size());
+    if (total < m_settings.minCalls) return false;
+    int failed = 0;
+    int slow = 0;
+    for (const Sample& s : m_window) {
+        if (s.failed) ++failed;
+        if (s.slow) ++slow;
+    }
+    bool tooManyFailures = failed * 100 >= m_settings.failurePercent * total;
+    bool tooSlow = slow * 100 >= m_settings.slowPercent * total;
+    if (!tooManyFailures && !tooSlow) return false;
+    return transitionTo(State::Open);
+}
+
+qint64 CircuitBreaker::nowMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <QtGlobal>
+#include <deque>
+#include <mutex>
+#include <functional>
+
+/**
+ * @brief Circuit Breaker for the Upstream Endpoint
+ * @brief 上游端点熔断器
+ *
+ * Closed: calls pass and their results fill a rolling window. When the window shows too many
+ * failures or too many slow calls, the breaker opens. Open: calls are refused at once, so
+ * workers are not tied up in retry loops against a dead API. After the cool-off a few probe
+ * calls are let through (half-open). Success closes the breaker again; a failure re-opens it.
+ * 关闭：请求正常通过，结果记入滚动窗口；窗口中失败或慢调用比例过高时熔断器打开。
+ * 打开：请求被立即拒绝，避免工作线程卡在对已宕机 API 的重试循环中。
+ * 冷却期后放行少量探测请求 (半开)；探测成功则重新关闭，失败则再次打开。
+ */
+class CircuitBreaker {
+public:
+    enum class State { Closed = 0, Open = 1, HalfOpen = 2 };
+
+    // Result of one guarded call / 一次受保护调用的结果
+    enum class Result {
+        Success,
+        Failure,  // Endpoint down: 5xx, timeout, connection error / 端点故障：5xx、超时、连接错误
+        Ignored   // Says nothing about the endpoint (e.g. 401, 429, shutdown) / 与端点健康无关 (如 401、429、停止服务)
+    };
+
+    struct Settings {
+        bool enabled = true;
+        int windowSize = 20;          // Calls in the rolling window / 滚动窗口内的调用数
+        int minCalls = 8;             // Calls needed before judging / 判定前所需的最少调用数
+        int failurePercent = 50;      // Open at this failure rate / 失败率达到该值时打开
+        int slowCallMs = 20000;       // A success slower than this counts as slow / 慢于该值的成功调用视为慢调用
+        int slowPercent = 80;         // Open at this slow-call rate / 慢调用比例达到该值时打开
+        int openMs = 15000;           // Time spent open before probing / 打开后到开始探测的时间
+        int halfOpenProbes = 1;       // Concurrent probes while half-open / 半开状态下允许的并发探测数
+    };
+
+    // Admission of one call, handed back to record(). A record() only affects the state period
+    // (generation) it was admitted in, so a late result of a call let through while closed cannot
+    // decide a half-open probe; only the probes themselves move the breaker out of half-open.
+    // 一次调用的放行凭证，需交回给 record()。record() 只作用于放行时所处的状态周期 (代)，
+    // 因此关闭期间放行的调用迟到的结果不能决定半开探测；只有探测请求本身能让熔断器离开半开状态。
+    struct Ticket {
+        bool allowed = false;
+        quint64 generation = 0; // State period the call was admitted in / 放行时所处的状态周期
+        explicit operator bool() const { return allowed; }
+    };
+
+    void configure(const Settings& settings);
+
+    // Called (outside the lock) whenever the state changes / 状态变化时调用 (在锁外)
+    void setListener(std::function<void(State)> listener);
+
+    // Ask before an upstream call; an allowed ticket means go ahead and report the result with record()
+    // 发起上游调用前询问；凭证放行表示可以调用，且之后必须用 record() 报告结果
+    Ticket allowRequest();
+
+    // Report the result of a call that allowRequest() let through
+    // 报告经 allowRequest() 放行的调用结果
+    void record(const Ticket& ticket, Result result, qint64 latencyMs);
+
+    // True while open and still cooling off (cheap check for the request handler)
+    // 处于打开且仍在冷却期时为 true (供请求处理函数快速判断)
+    bool isRejecting() const;
+
+    State state() const;
+
+private:
+    struct Sample {
+        bool failed;
+        bool slow;
+    };
+
+    // Both expect m_mutex held; return true if the state changed (and start a new generation)
+    // 调用时须持有 m_mutex；状态变化时返回 true (并开始新的一代)
+    bool transitionTo(State next);
+    bool tripIfUnhealthy();
+
+    static qint64 nowMs();
+
+    Settings m_settings;
+    State m_state = State::Closed;
+    quint64 m_generation = 1; // Bumped on every state change / 每次状态变化时递增
+    std::deque<Sample> m_window;
+    qint64 m_openedAt = 0;
+    int m_probesInFlight = 0;
+    std::function<void(State)> m_listener;
+    mutable std::mutex m_mutex;
+};
@@ -0,0 +1,267 @@
+#include "CompiledGlossary.h"
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QMap>
+#include <QHash>
+#include <QDebug>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+namespace {
+constexpr char kMagic[8] = {'X', 'U', 'G', 'L', 'O', 'S', 'S', '1'};
+constexpr quint32 kVersion = 1;
+
+// Sections start on 8-byte boundaries / 各段按 8 字节对齐
+qint64 align8(qint64 n) { return (n + 7) & ~qint64(7); }
+} // namespace
+
+struct CompiledGlossary::Header {
+    char magic[8];
+    quint32 version;
+    quint32 termCount;
+    qint64 sourceSize;    // Size of the .txt it was built from / 源 .txt 的大小
+    qint64 sourceMtime;   // Modification time of the .txt (ms since epoch) / 源 .txt 的修改时间 (毫秒)
+    qint64 entriesOffset; // Entry[termCount]
+    qint64 stringsOffset; // char16_t[stringUnits]
+    qint64 stringUnits;
+    qint64 statesOffset;  // FlatState[stateCount]
+    qint64 stateCount;
+    qint64 edgesOffset;   // FlatEdge[edgeCount]
+    qint64 edgeCount;
+    qint64 nextSameOffset; // qint32[termCount]
+    qint64 totalSize;
+};
+
+bool CompiledGlossary::open(const QString& sourcePath) {
+    close();
+    QFileInfo source(sourcePath);
+    if (!source.exists()) return false;
+    const qint64 sourceSize = source.size();
+    const qint64 sourceMtime = source.lastModified().toMSecsSinceEpoch();
+
+    // 1. Up-to-date sidecar: map it and we are done / 伴随文件未过期：直接映射
+    m_file.setFileName(sidecarPath(sourcePath));
+    if (m_file.open(QIODevice::ReadOnly)) {
+        m_mapped = m_file.map(0, m_file.size());
+        if (m_mapped && attach(m_mapped, m_file.size(), sourceSize, sourceMtime)) {
+            m_fromCache = true;
+            return true;
+        }
+        close();
+    }
+
+    // 2. Compile and use the image from memory; the owner saves the sidecar with saveSidecar()
+    // once the old one is no longer mapped
+    // 编译并在内存中使用映像；旧伴随文件不再被映射后，由持有者调用 saveSidecar() 保存
+    QByteArray image = compile(sourcePath, sourceSize, sourceMtime);
+    if (image.isEmpty()) return false;
+    m_sidecarPath = sidecarPath(sourcePath);
+    m_buffer = image;
+    return attach(reinterpret_cast<const uchar*>(m_buffer.constData()), m_buffer.size(), sourceSize, sourceMtime);
+}
+
+bool CompiledGlossary::saveSidecar() const {
+    if (!needsSave()) return false;
+    QSaveFile out(m_sidecarPath);
+    if (out.open(QIODevice::WriteOnly) && out.write(m_buffer) == m_buffer.size() && out.commit()) return true;
+    qWarning() << "Glossary sidecar not writable, using in-memory image:" << m_sidecarPath << out.errorString();
+    return false;
+}
+
+void CompiledGlossary::close() {
+    if (m_mapped) m_file.unmap(m_mapped);
+    m_mapped = nullptr;
+    if (m_file.isOpen()) m_file.close();
+    m_sidecarPath.clear();
+    m_buffer.clear();
+    m_fromCache = false;
+    m_header = nullptr;
+    m_termCount = 0;
+    m_entries = nullptr;
+    m_strings = nullptr;
+    m_matcher = FlatAhoCorasick();
+}
+
+QStringView CompiledGlossary::key(int id) const {
+    const Entry& e = m_entries[id];
+    return QStringView(m_strings + e.keyOffset, qsizetype(e.keyLength));
+}
+
+QStringView CompiledGlossary::value(int id) const {
+    const Entry& e = m_entries[id];
+    return QStringView(m_strings + e.valueOffset, qsizetype(e.valueLength));
+}
+
+int CompiledGlossary::indexOf(QStringView k) const {
+    // Entries are sorted like QMap keys / 条目与 QMap 的 Key 顺序一致
+    int lo = 0;
+    int hi = termCount();
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (key(mid).compare(k) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return (lo < termCount() && key(lo) == k) ? lo : -1;
+}
+
+QByteArray CompiledGlossary::compile(const QString& sourcePath, qint64 sourceSize, qint64 sourceMtime) {
+    QFile file(sourcePath);
+    if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+
+    // XUnity 格式通常是 Original=Translated；同名 Key 以后出现的为准
+    // XUnity format is typically Original=Translated; a later duplicate key wins
+    QMap<QString, QString> terms;
+    const QString content = QString::fromUtf8(file.readAll());
+    QStringView text(content);
+    if (text.startsWith(QChar(0xFEFF))) text = text.sliced(1); // Skip the UTF-8 BOM / 跳过 UTF-8 BOM
+    for (QStringView line : text.split(u'\n')) {
+        qsizetype idx = line.indexOf(u'=');
+        if (idx <= 0) continue;
+        QString key = line.left(idx).trimmed().toString();
+        QString val = line.mid(idx + 1).trimmed().toString();
+        if (!key.isEmpty() && !val.isEmpty()) terms.insert(key, val);
+    }
+
+    // Interned string pool: identical strings (common among values) are stored once
+    // 去重的字符串池：相同的字符串 (译文中很常见) 只存一份
+    std::vector<Entry> entries;
+    entries.reserve(terms.size());
+    QString pool;
+    QHash<QString, quint32> interned;
+    auto intern = [&](const QString& s) -> quint32 {
+        auto it = interned.constFind(s);
+        if (it != interned.constEnd()) return it.value();
+        quint32 offset = quint32(pool.size());
+        pool += s;
+        interned.insert(s, offset);
+        return offset;
+    };
+    QStringList keys;
+    keys.reserve(terms.size());
+    for (auto it = terms.constBegin(); it != terms.constEnd(); ++it) {
+        entries.push_back({intern(it.key()), quint32(it.key().size()), intern(it.value()), quint32(it.value().size())});
+        keys << it.key();
+    }
+
+    AhoCorasick matcher;
+    matcher.build(keys);
+    std::vector<AhoCorasick::FlatState> states;
+    std::vector<AhoCorasick::FlatEdge> edges;
+    std::vector<qint32> nextSame;
+    matcher.flatten(states, edges, nextSame);
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.termCount = quint32(entries.size());
+    header.sourceSize = sourceSize;
+    header.sourceMtime = sourceMtime;
+    header.entriesOffset = align8(sizeof(Header));
+    header.stringsOffset = align8(header.entriesOffset + qint64(entries.size() * sizeof(Entry)));
+    header.stringUnits = pool.size();
+    header.statesOffset = align8(header.stringsOffset + header.stringUnits * qint64(sizeof(char16_t)));
+    header.stateCount = qint64(states.size());
+    header.edgesOffset = align8(header.statesOffset + qint64(states.size() * sizeof(AhoCorasick::FlatState)));
+    header.edgeCount = qint64(edges.size());
+    header.nextSameOffset = align8(header.edgesOffset + qint64(edges.size() * sizeof(AhoCorasick::FlatEdge)));
+    header.totalSize = header.nextSameOffset + qint64(nextSame.size() * sizeof(qint32));
+
+    QByteArray image(header.totalSize, '\0');
+    char* base = image.data();
+    std::memcpy(base, &header, sizeof(header));
+    if (!entries.empty()) std::memcpy(base + header.entriesOffset, entries.data(), entries.size() * sizeof(Entry));
+    if (!pool.isEmpty()) std::memcpy(base + header.stringsOffset, pool.utf16(), size_t(pool.size()) * sizeof(char16_t));
+    std::memcpy(base + header.statesOffset, states.data(), states.size() * sizeof(AhoCorasick::FlatState));
+    if (!edges.empty()) std::memcpy(base + header.edgesOffset, edges.data(), edges.size() * sizeof(AhoCorasick::FlatEdge));
+    if (!nextSame.empty()) std::memcpy(base + header.nextSameOffset, nextSame.data(), nextSame.size() * sizeof(qint32));
+    return image;
+}
+
+bool CompiledGlossary::attach(const uchar* data, qint64 size, qint64 sourceSize, qint64 sourceMtime) {
+    if (size < qint64(sizeof(Header))) return false;
+    const Header* h = reinterpret_cast<const Header*>(data);
+    if (std::memcmp(h->magic, kMagic, sizeof(kMagic)) != 0 || h->version != kVersion) return false;
+    if (h->totalSize != size) return false;
+    // Stale: the .txt changed since it was compiled / 已过期：编译后 .txt 被修改过
+    if (h->sourceSize != sourceSize || h->sourceMtime != sourceMtime) return false;
+
+    // Every section must lie inside the image, on its 8-byte boundary / 各段必须位于映像范围内并按 8 字节对齐
+    auto inside = [size](qint64 offset, qint64 bytes) {
+        return offset >= 0 && offset % 8 == 0 && bytes >= 0 && bytes <= size && offset <= size - bytes;
+    };
+    // Ids are ints; counts are bounded before they are multiplied / 编号为 int 类型；计数先限定范围再做乘法
+    if (h->termCount > quint32(std::numeric_limits<qint32>::max()) ||
+        h->stateCount > std::numeric_limits<qint32>::max() ||
+        h->stringUnits < 0 || h->stringUnits > size ||
+        h->edgeCount < 0 || h->edgeCount > size ||
+        h->stateCount < 1 ||
+        !inside(h->entriesOffset, qint64(h->termCount) * qint64(sizeof(Entry))) ||
+        !inside(h->stringsOffset, h->stringUnits * qint64(sizeof(char16_t))) ||
+        !inside(h->statesOffset, h->stateCount * qint64(sizeof(AhoCorasick::FlatState))) ||
+        !inside(h->edgesOffset, h->edgeCount * qint64(sizeof(AhoCorasick::FlatEdge))) ||
+        !inside(h->nextSameOffset, qint64(h->termCount) * qint64(sizeof(qint32)))) {
+        return false;
+    }
+    if (!validate(data, h)) return false;
+
+    m_header = h;
+    m_termCount = int(h->termCount);
+    m_entries = reinterpret_cast<const Entry*>(data + h->entriesOffset);
+    m_strings = reinterpret_cast<const char16_t*>(data + h->stringsOffset);
+    m_matcher = FlatAhoCorasick(reinterpret_cast<const AhoCorasick::FlatState*>(data + h->statesOffset),
+                                reinterpret_cast<const AhoCorasick::FlatEdge*>(data + h->edgesOffset),
+                                reinterpret_cast<const qint32*>(data + h->nextSameOffset));
+    return true;
+}
+
+bool CompiledGlossary::validate(const uchar* data, const Header* h) {
+    const qint64 termCount = qint64(h->termCount);
+    const qint64 stateCount = h->stateCount;
+
+    // Entries: both strings inside the pool / 条目：键与值都位于字符串池内
+    const Entry* entries = reinterpret_cast<const Entry*>(data + h->entriesOffset);
+    for (qint64 i = 0; i < termCount; ++i) {
+        const Entry& e = entries[i];
+        if (qint64(e.keyOffset) + qint64(e.keyLength) > h->stringUnits ||
+            qint64(e.valueOffset) + qint64(e.valueLength) > h->stringUnits) {
+            return false;
+        }
+    }
+
+    // Patterns sharing a state are chained from higher to lower ids, so the chain ends
+    // 共享同一状态的模式按编号从大到小串联，因此链一定会结束
+    const qint32* nextSame = reinterpret_cast<const qint32*>(data + h->nextSameOffset);
+    for (qint64 id = 0; id < termCount; ++id) {
+        if (nextSame[id] < -1 || nextSame[id] >= id) return false;
+    }
+
+    // States: edges inside the edge table, and each link in range. Edges go exactly one level
+    // deeper, failure and dictionary links strictly shallower, so scanning always terminates and
+    // a match never starts before the text.
+    // 状态：边位于边表内，各链接都在范围内。边恰好深入一层，失败链接与字典链接严格变浅，
+    // 因此扫描一定会结束，匹配位置也不会早于文本起点。
+    const AhoCorasick::FlatState* states = reinterpret_cast<const AhoCorasick::FlatState*>(data + h->statesOffset);
+    const AhoCorasick::FlatEdge* edges = reinterpret_cast<const AhoCorasick::FlatEdge*>(data + h->edgesOffset);
+    auto validState = [stateCount](qint64 s) { return s >= 0 && s < stateCount; };
+    if (states[0].depth != 0 || states[0].fail != 0) return false;
+    for (qint64 s = 0; s < stateCount; ++s) {
+        const AhoCorasick::FlatState& state = states[s];
+        if (qint64(state.edgeStart) + qint64(state.edgeCount) > h->edgeCount) return false;
+        if (state.output < -1 || state.output >= termCount) return false;
+        if (!validState(state.fail)) return false;
+        if (s != 0 && states[state.fail].depth >= state.depth) return false;
+        if (state.dictLink != -1 &&
+            (!validState(state.dictLink) || states[state.dictLink].depth >= state.depth)) {
+            return false;
+        }
+        for (quint32 k = 0; k < state.edgeCount; ++k) {
+            const AhoCorasick::FlatEdge& edge = edges[state.edgeStart + k];
+            if (edge.target <= 0 || edge.target >= stateCount) return false;
+            if (states[edge.target].depth != state.depth + 1) return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <QString>
+#include <QStringView>
+#include <QByteArray>
+#include <QFile>
+#include <vector>
+#include "AhoCorasick.h"
+
+/**
+ * @brief Memory-mapped Compiled Glossary
+ * @brief 内存映射的已编译术语表
+ *
+ * A binary sidecar ("<glossary>.bin") holding the sorted term table, an interned UTF-16
+ * string pool and the flattened Aho-Corasick automaton over all keys. It is mapped straight
+ * into memory and searched in place; opening it only walks the tables once to check every
+ * offset and index, without parsing or allocating.
+ * 二进制伴随文件 ("<术语表>.bin")，包含排序后的术语表、去重的 UTF-16 字符串池以及
+ * 所有 Key 的平坦化 Aho-Corasick 自动机。文件直接映射到内存并原地查找；打开时只顺序遍历
+ * 各表一次以校验所有偏移与下标，无需解析或分配内存。
+ *
+ * The sidecar records the size and modification time of its source .txt and is rebuilt
+ * whenever they no longer match. A freshly compiled image is used from memory; the owner
+ * writes it out with saveSidecar() once no other instance maps the old sidecar (Windows
+ * cannot replace a mapped file), and later runs map it.
+ * 伴随文件记录了源 .txt 的大小与修改时间，不一致时自动重建。新编译的映像在内存中使用；
+ * 持有者在没有其他实例映射旧伴随文件后 (Windows 无法替换仍被映射的文件) 调用
+ * saveSidecar() 写出，之后的运行直接映射。
+ *
+ * Read-only after open(); the owner guards replacement.
+ * open() 之后只读；替换时由持有者负责加锁。
+ */
+class CompiledGlossary {
+public:
+    CompiledGlossary() = default;
+    ~CompiledGlossary() { close(); }
+    CompiledGlossary(const CompiledGlossary&) = delete;
+    CompiledGlossary& operator=(const CompiledGlossary&) = delete;
+
+    // Open the sidecar of sourcePath; if it is missing, stale or damaged, compile into memory instead
+    // 打开 sourcePath 对应的伴随文件；缺失、过期或损坏时改为在内存中编译
+    bool open(const QString& sourcePath);
+
+    // Whether the image was compiled this time and the sidecar still has to be written
+    // 映像是否为本次编译、尚需写出伴随文件
+    bool needsSave() const { return !m_fromCache && !m_buffer.isEmpty(); }
+
+    // Write the in-memory image to the sidecar (atomically, via QSaveFile). The old sidecar must
+    // no longer be mapped by any instance. This instance keeps using its in-memory image.
+    // 将内存中的映像写入伴随文件 (通过 QSaveFile 原子替换)。旧伴随文件必须已不再被任何实例映射。
+    // 本实例继续使用内存中的映像。
+    bool saveSidecar() const;
+
+    void close();
+
+    // Number of terms (ids are 0..termCount()-1, in key order) / 术语数量 (编号 0..termCount()-1，按 Key 排序)
+    int termCount() const { return m_termCount; }
+
+    // Zero-copy views into the image, valid until close() / 指向映像的零拷贝视图，close() 前有效
+    QStringView key(int id) const;
+    QStringView value(int id) const;
+
+    // Id of an exact (case-sensitive) key, -1 if absent / 精确 (区分大小写) 查找 Key 的编号，不存在返回 -1
+    int indexOf(QStringView key) const;
+
+    // All key occurrences in text / 文本中所有 Key 的出现位置
+    std::vector<AhoCorasick::Match> findAll(const QString& text) const { return m_matcher.findAll(text); }
+
+    // Whether the image came from an up-to-date sidecar (false = compiled this time)
+    // 映像是否来自最新的伴随文件 (false 表示本次重新编译)
+    bool loadedFromCache() const { return m_fromCache; }
+
+    // Sidecar path for a glossary file / 术语表文件对应的伴随文件路径
+    static QString sidecarPath(const QString& sourcePath) { return sourcePath + ".bin"; }
+
+private:
+    struct Header;
+    struct Entry {
+        quint32 keyOffset;   // In code units from the start of the string pool / 相对字符串池起点的码元偏移
+        quint32 keyLength;
+        quint32 valueOffset;
+        quint32 valueLength;
+    };
+
+    // Parse the .txt and serialize the whole image / 解析 .txt 并序列化完整映像
+    static QByteArray compile(const QString& sourcePath, qint64 sourceSize, qint64 sourceMtime);
+
+    // Point the accessors at an image; false if it is malformed or stale
+    // 将访问器指向一份映像；格式错误或已过期时返回 false
+    bool attach(const uchar* data, qint64 size, qint64 sourceSize, qint64 sourceMtime);
+
+    // Check that every entry lies in the string pool and every state, edge and link of the automaton
+    // points inside its table (and cannot loop), so a damaged sidecar is rebuilt instead of read out of bounds
+    // 校验每个条目都位于字符串池内，自动机的每个状态、边和链接都指向表内 (且不会成环)，
+    // 损坏的伴随文件因此会被重建，而不是越界读取
+    static bool validate(const uchar* data, const Header* h);
+
+    QString m_sidecarPath;
+    QFile m_file;
+    uchar* m_mapped = nullptr;
+    QByteArray m_buffer; // Used when the sidecar could not be mapped / 无法映射伴随文件时使用
+    bool m_fromCache = false;
+
+    const Header* m_header = nullptr;
+    int m_termCount = 0;
+    const Entry* m_entries = nullptr;
+    const char16_t* m_strings = nullptr;
+    FlatAhoCorasick m_matcher;
+};
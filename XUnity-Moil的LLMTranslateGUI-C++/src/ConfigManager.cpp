@@ -1,4 +1,5 @@
 #include "ConfigManager.h"
+#include <algorithm>
 
 // 实现加载配置的函数
 // Implementation of the function to load configuration
@@ -28,6 +29,53 @@ AppConfig ConfigManager::loadConfig(const QString& filename) {
     // Read glossary-related settings
     config.enable_glossary = settings.value("Settings/enable_glossary", config.enable_glossary).toBool();
     config.glossary_path = settings.value("Settings/glossary_path", config.glossary_path).toString();
+
+    // 读取翻译缓存相关设置
+    // Read translation cache settings
+    config.enable_cache = settings.value("Settings/enable_cache", config.enable_cache).toBool();
+    config.cache_path = settings.value("Settings/cache_path", config.cache_path).toString();
+    config.memory_cache_bytes = settings.value("Settings/memory_cache_bytes", config.memory_cache_bytes).toLongLong();
+
+    // 读取术语注入预算
+    // Read glossary budget
+    config.glossary_token_budget = settings.value("Settings/glossary_token_budget", config.glossary_token_budget).toInt();
+    config.regex_profiling = settings.value("Settings/regex_profiling", config.regex_profiling).toBool();
+
+    // 读取对话上下文相关设置
+    // Read conversation context settings
+    config.context_memory_bytes = settings.value("Settings/context_memory_bytes", config.context_memory_bytes).toLongLong();
+    config.context_idle_minutes = settings.value("Settings/context_idle_minutes", config.context_idle_minutes).toInt();
+    config.context_token_budget = settings.value("Settings/context_token_budget", config.context_token_budget).toInt();
+    config.context_key_param = settings.value("Settings/context_key_param", config.context_key_param).toString();
+    config.stable_prompt_prefix = settings.value("Settings/stable_prompt_prefix", config.stable_prompt_prefix).toBool();
+
+    // 读取批量翻译相关设置
+    // Read micro-batching settings
+    config.enable_batch = settings.value("Settings/enable_batch", config.enable_batch).toBool();
+    config.batch_window_ms = settings.value("Settings/batch_window_ms", config.batch_window_ms).toInt();
+    config.batch_max_lines = settings.value("Settings/batch_max_lines", config.batch_max_lines).toInt();
+
+    // 读取上游连接相关设置
+    // Read upstream connection settings
+    config.enable_http2 = settings.value("Settings/enable_http2", config.enable_http2).toBool();
+    config.http2_connections = settings.value("Settings/http2_connections", config.http2_connections).toInt();
+    config.enable_streaming = settings.value("Settings/enable_streaming", config.enable_streaming).toBool();
+
+    // 读取重试策略
+    // Read retry policy
+    config.retry_max_attempts = settings.value("Settings/retry_max_attempts", config.retry_max_attempts).toInt();
+    config.retry_base_delay_ms = settings.value("Settings/retry_base_delay_ms", config.retry_base_delay_ms).toInt();
+    config.retry_max_delay_ms = settings.value("Settings/retry_max_delay_ms", config.retry_max_delay_ms).toInt();
+    config.request_deadline_ms = settings.value("Settings/request_deadline_ms", config.request_deadline_ms).toInt();
+    // 过小的截止时间会让每个请求立即超时 / A tiny deadline would time out every request at once
+    if (config.request_deadline_ms > 0) config.request_deadline_ms = std::max(1000, config.request_deadline_ms);
+
+    // 读取熔断器设置
+    // Read circuit breaker settings
+    config.enable_circuit_breaker = settings.value("Settings/enable_circuit_breaker", config.enable_circuit_breaker).toBool();
+    config.breaker_failure_percent = settings.value("Settings/breaker_failure_percent", config.breaker_failure_percent).toInt();
+    config.breaker_slow_call_ms = settings.value("Settings/breaker_slow_call_ms", config.breaker_slow_call_ms).toInt();
+    config.breaker_open_seconds = settings.value("Settings/breaker_open_seconds", config.breaker_open_seconds).toInt();
     
     return config;
 }
@@ -57,6 +105,51 @@ void ConfigManager::saveConfig(const AppConfig& config, const QString& filename)
     // Save glossary-related settings
     settings.setValue("Settings/enable_glossary", config.enable_glossary);
     settings.setValue("Settings/glossary_path", config.glossary_path);
+
+    // 保存翻译缓存相关设置
+    // Save translation cache settings
+    settings.setValue("Settings/enable_cache", config.enable_cache);
+    settings.setValue("Settings/cache_path", config.cache_path);
+    settings.setValue("Settings/memory_cache_bytes", config.memory_cache_bytes);
+
+    // 保存术语注入预算
+    // Save glossary budget
+    settings.setValue("Settings/glossary_token_budget", config.glossary_token_budget);
+    settings.setValue("Settings/regex_profiling", config.regex_profiling);
+
+    // 保存对话上下文相关设置
+    // Save conversation context settings
+    settings.setValue("Settings/context_memory_bytes", config.context_memory_bytes);
+    settings.setValue("Settings/context_idle_minutes", config.context_idle_minutes);
+    settings.setValue("Settings/context_token_budget", config.context_token_budget);
+    settings.setValue("Settings/context_key_param", config.context_key_param);
+    settings.setValue("Settings/stable_prompt_prefix", config.stable_prompt_prefix);
+
+    // 保存批量翻译相关设置
+    // Save micro-batching settings
+    settings.setValue("Settings/enable_batch", config.enable_batch);
+    settings.setValue("Settings/batch_window_ms", config.batch_window_ms);
+    settings.setValue("Settings/batch_max_lines", config.batch_max_lines);
+
+    // 保存上游连接相关设置
+    // Save upstream connection settings
+    settings.setValue("Settings/enable_http2", config.enable_http2);
+    settings.setValue("Settings/http2_connections", config.http2_connections);
+    settings.setValue("Settings/enable_streaming", config.enable_streaming);
+
+    // 保存重试策略
+    // Save retry policy
+    settings.setValue("Settings/retry_max_attempts", config.retry_max_attempts);
+    settings.setValue("Settings/retry_base_delay_ms", config.retry_base_delay_ms);
+    settings.setValue("Settings/retry_max_delay_ms", config.retry_max_delay_ms);
+    settings.setValue("Settings/request_deadline_ms", config.request_deadline_ms);
+
+    // 保存熔断器设置
+    // Save circuit breaker settings
+    settings.setValue("Settings/enable_circuit_breaker", config.enable_circuit_breaker);
+    settings.setValue("Settings/breaker_failure_percent", config.breaker_failure_percent);
+    settings.setValue("Settings/breaker_slow_call_ms", config.breaker_slow_call_ms);
+    settings.setValue("Settings/breaker_open_seconds", config.breaker_open_seconds);
     
     // 强制将更改同步到磁盘（确保数据被写入）
     // Force synchronization of changes to disk (ensure data is written)
@@ -32,6 +32,76 @@ struct AppConfig {
     // _Substitutions.txt 路径 / Path to _Substitutions.txt
     QString glossary_path = "";   
 
+    // --- 翻译缓存 / Translation Cache ---
+    // 是否开启持久化翻译缓存 / Whether to enable the persistent translation cache
+    bool enable_cache = false;
+    // 缓存文件路径 (留空则只使用内存缓存) / Path of the cache file (empty = memory cache only)
+    QString cache_path = "translation_cache.txt";
+    // 内存热点缓存的字节预算 (0 表示禁用) / Byte budget of the in-memory hot cache (0 = disabled)
+    qint64 memory_cache_bytes = 16 * 1024 * 1024;
+
+    // 术语注入的 Token 预算 (0 表示不限) / Token budget for injected glossary terms (0 = unlimited)
+    int glossary_token_budget = 300;
+    // 正则规则性能分析：逐条计时并定期输出最慢的规则 / Regex profiling: time every rule and log the slowest ones periodically
+    bool regex_profiling = false;
+
+    // --- 对话上下文 / Conversation Context ---
+    // 所有上下文的内存上限 (字节，0 表示不限) / Memory cap of all contexts (bytes, 0 = unlimited)
+    qint64 context_memory_bytes = 8 * 1024 * 1024;
+    // 上下文空闲多少分钟后移除 (0 表示永不) / Minutes of inactivity before a context is dropped (0 = never)
+    int context_idle_minutes = 30;
+    // 上下文历史的 Token 预算，从最新一轮开始保留 (0 表示只按轮数限制)
+    // Token budget of the context history, newest rounds kept first (0 = limited by rounds only)
+    int context_token_budget = 0;
+    // 细分上下文的请求头或查询参数名，如场景、说话人 (留空则按客户端区分)
+    // Header or query parameter that splits a client's context, e.g. scene or speaker (empty = per client)
+    QString context_key_param = "";
+    // 提示词前缀缓存友好布局：系统提示词保持不变，术语与指令放入最后一条用户消息
+    // Prefix-cache-friendly layout: keep the system prompt byte-stable, put glossary and instructions in the last user message
+    // 同时历史按半个窗口 (context_num 或 context_token_budget 的一半) 整块丢弃，而不是每轮滑动
+    // History is also dropped half a window (of context_num or context_token_budget) at a time instead of sliding every round
+    bool stable_prompt_prefix = false;
+
+    // --- 批量翻译 / Micro-batching ---
+    // 是否将短时间内的请求合并为一次编号多行请求；批量模式不使用对话上下文，也不提取新术语
+    // Whether to merge nearby requests into one numbered multi-line call; batch mode uses no
+    // conversation context and extracts no new terms
+    bool enable_batch = false;
+    // 收集窗口 (毫秒) / Collection window (ms)
+    int batch_window_ms = 50;
+    // 每批最多行数 / Maximum lines per batch
+    int batch_max_lines = 20;
+
+    // --- 上游连接 / Upstream Connections ---
+    // 服务器支持时使用 HTTP/2 多路复用 / Use multiplexed HTTP/2 when the server supports it
+    bool enable_http2 = true;
+    // HTTP/2 连接数 (所有并发请求在这些连接上复用) / Number of HTTP/2 connections shared by all concurrent calls
+    int http2_connections = 2;
+    // 流式接收 (SSE)，收到 </tl> 即返回译文 / Stream the reply (SSE) and return as soon as </tl> arrives
+    bool enable_streaming = false;
+
+    // --- 重试策略 / Retry Policy ---
+    // 每句最多尝试次数 / Maximum attempts per line
+    int retry_max_attempts = 5;
+    // 退避基础等待 (毫秒)，每次重试翻倍 / Base backoff (ms), doubled on every retry
+    int retry_base_delay_ms = 500;
+    // 退避等待上限 (毫秒) / Backoff cap (ms)
+    int retry_max_delay_ms = 8000;
+    // 单个 XUnity 请求的总截止时间 (毫秒，≤ 0 表示不设截止时间，正值至少为 1000)；剩余不足 5 秒时不再重试
+    // Overall deadline for one XUnity request (ms; ≤ 0 = no deadline, positive values are at least 1000);
+    // no retry is started with less than 5 s left
+    int request_deadline_ms = 60000;
+
+    // --- 熔断器 / Circuit Breaker ---
+    // API 持续失败时暂停调用并快速返回 503 / Pause API calls and answer 503 fast while the API keeps failing
+    bool enable_circuit_breaker = true;
+    // 滚动窗口内失败率达到该百分比时熔断 / Open at this failure percentage in the rolling window
+    int breaker_failure_percent = 50;
+    // 慢于该值 (毫秒) 的调用视为慢调用 / Calls slower than this (ms) count as slow
+    int breaker_slow_call_ms = 20000;
+    // 熔断后多久开始探测 (秒) / Seconds to stay open before probing
+    int breaker_open_seconds = 15;
+
     // 构造函数 / Constructor
     AppConfig() {
         // 初始化默认的系统提示词
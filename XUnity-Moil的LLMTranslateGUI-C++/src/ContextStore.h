@@ -0,0 +1,203 @@
+#pragma once
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <array>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <utility>
+
+/**
+ * @brief Sharded Conversation Context Store
+ * @brief 分片对话上下文存储
+ *
+ * Keeps the chat history of every client (or finer context key). Each shard has its own
+ * mutex and LRU list, so requests of unrelated clients rarely touch the same lock.
+ * Contexts unused for longer than the idle timeout are dropped, and a byte budget split
+ * evenly across shards evicts the least recently used contexts first.
+ * 保存每个客户端 (或更细的上下文键) 的聊天记录。每个分片有独立的互斥锁和 LRU 链表，
+ * 无关客户端的请求几乎不会争用同一把锁。超过空闲时限未使用的上下文会被移除，
+ * 总字节预算平均分配到各分片，超出时优先淘汰最久未使用的上下文。
+ *
+ * Requests take a snapshot, call the API without any lock, then commit the new round.
+ * 请求先取快照，在不持锁的情况下调用 API，再提交新的一轮对话。
+ */
+class ContextStore {
+public:
+    static constexpr int SHARD_COUNT = 16;
+
+    // Pairs of (User Input, Assistant Response) / (用户输入, AI助手回复) 的成对历史
+    using History = std::deque<std::pair<QString, QString>>;
+
+    // Copy of a history taken under a short lock / 在短暂持锁期间取得的历史副本
+    struct Snapshot {
+        History history; // QString is implicitly shared, copying is cheap / QString 为隐式共享，复制开销很小
+        quint64 epoch = 0; // Instance the snapshot came from / 快照来源的上下文实例
+    };
+
+    struct Stats {
+        int contexts = 0;
+        qint64 bytes = 0;
+        quint64 idleEvictions = 0;
+        quint64 budgetEvictions = 0;
+    };
+
+    // Set the total byte budget (0 = unlimited) and the idle timeout (0 = never expire).
+    // trimInBlocks drops half of maxRounds at once, so the history prefix stays the same between trims
+    // 设置总字节预算 (0 表示不限) 和空闲时限 (0 表示永不过期)。
+    // trimInBlocks 时一次丢弃 maxRounds 的一半，使两次截断之间历史前缀保持不变
+    void configure(qint64 budgetBytes, qint64 idleMs, bool trimInBlocks = false) {
+        m_budget = budgetBytes > 0 ? budgetBytes : 0;
+        m_idleMs = idleMs > 0 ? idleMs : 0;
+        m_trimInBlocks = trimInBlocks;
+        const qint64 now = nowMs();
+        for (auto& shard : m_shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            evict(shard, now);
+        }
+    }
+
+    // Copy the history of key, creating an empty context if needed; maxRounds trims it
+    // 复制 key 的历史 (必要时创建空上下文)；按 maxRounds 截断
+    Snapshot snapshot(const QByteArray& key, int maxRounds) {
+        const qint64 now = nowMs();
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        evict(shard, now);
+
+        auto it = shard.index.find(key);
+        if (it == shard.index.end()) {
+            shard.order.push_front({key, History(), ++m_nextEpoch, nodeBytes(key), now});
+            it = shard.index.insert(key, shard.order.begin());
+            shard.bytes += shard.order.front().bytes;
+        } else {
+            // Move to the front (most recently used) / 移到链表头部 (最近使用)
+            shard.order.splice(shard.order.begin(), shard.order, it.value());
+        }
+
+        Node& node = *it.value();
+        node.lastUsedMs = now;
+        trim(shard, node, maxRounds);
+        return {node.history, node.epoch};
+    }
+
+    // Append one round, unless the context was evicted or replaced since the snapshot.
+    // Concurrent requests of one key commit in completion order.
+    // 追加一轮对话；若自快照以来上下文已被淘汰或替换则放弃。同一键的并发请求按完成顺序提交。
+    void commit(const QByteArray& key, const Snapshot& snapshot, int maxRounds,
+                const QString& userContent, const QString& assistantContent) {
+        const qint64 now = nowMs();
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        auto it = shard.index.find(key);
+        if (it == shard.index.end() || it.value()->epoch != snapshot.epoch) return;
+
+        Node& node = *it.value();
+        shard.order.splice(shard.order.begin(), shard.order, it.value());
+        node.lastUsedMs = now;
+        node.history.push_back({userContent, assistantContent});
+        node.bytes += roundBytes(userContent, assistantContent);
+        shard.bytes += roundBytes(userContent, assistantContent);
+        trim(shard, node, maxRounds);
+        evict(shard, now);
+    }
+
+    void clear() {
+        for (auto& shard : m_shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.order.clear();
+            shard.index.clear();
+            shard.bytes = 0;
+        }
+    }
+
+    Stats stats() const {
+        Stats s;
+        s.idleEvictions = m_idleEvictions.load(std::memory_order_relaxed);
+        s.budgetEvictions = m_budgetEvictions.load(std::memory_order_relaxed);
+        for (auto& shard : m_shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            s.bytes += shard.bytes;
+            s.contexts += shard.index.size();
+        }
+        return s;
+    }
+
+private:
+    struct Node {
+        QByteArray key;
+        History history;
+        quint64 epoch;
+        qint64 bytes;
+        qint64 lastUsedMs;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Node> order; // Front = most recently used / 头部 = 最近使用
+        QHash<QByteArray, std::list<Node>::iterator> index;
+        qint64 bytes = 0;
+    };
+
+    // Approximate heap footprint: UTF-16 text + deque/list/hash node overhead
+    // 近似内存占用：UTF-16 文本 + deque/链表/哈希节点开销
+    static qint64 roundBytes(const QString& user, const QString& assistant) {
+        return (user.size() + assistant.size()) * qint64(sizeof(QChar)) + 64;
+    }
+    static qint64 nodeBytes(const QByteArray& key) { return key.size() + 160; }
+
+    static qint64 nowMs() {
+        using namespace std::chrono;
+        return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    qint64 shardBudget() const { return m_budget / SHARD_COUNT; }
+
+    Shard& shardFor(const QByteArray& key) {
+        return m_shards[qHash(key) % SHARD_COUNT];
+    }
+
+    void trim(Shard& shard, Node& node, int maxRounds) {
+        const size_t limit = size_t(std::max(0, maxRounds));
+        if (node.history.size() <= limit) return;
+        const size_t keep = m_trimInBlocks ? limit / 2 : limit;
+        while (node.history.size() > keep) {
+            const qint64 bytes = roundBytes(node.history.front().first, node.history.front().second);
+            node.bytes -= bytes;
+            shard.bytes -= bytes;
+            node.history.pop_front();
+        }
+    }
+
+    // The LRU tail is both the least recently and the longest unused, so both limits evict from there.
+    // The budget never evicts the last context of a shard (its size is bounded by maxRounds).
+    // LRU 尾部既是最久未使用的，也是空闲最久的，因此两种限制都从尾部淘汰。
+    // 预算不会淘汰分片中最后一个上下文 (其大小受 maxRounds 限制)。
+    void evict(Shard& shard, qint64 now) {
+        const qint64 idleMs = m_idleMs;
+        const qint64 budget = shardBudget();
+        while (!shard.order.empty()) {
+            const Node& victim = shard.order.back();
+            const bool idle = idleMs > 0 && now - victim.lastUsedMs > idleMs;
+            const bool overBudget = budget > 0 && shard.bytes > budget && shard.order.size() > 1;
+            if (!idle && !overBudget) break;
+            (idle ? m_idleEvictions : m_budgetEvictions).fetch_add(1, std::memory_order_relaxed);
+            shard.bytes -= victim.bytes;
+            shard.index.remove(victim.key);
+            shard.order.pop_back();
+        }
+    }
+
+    std::atomic<qint64> m_budget{0};
+    std::atomic<qint64> m_idleMs{0};
+    std::atomic<bool> m_trimInBlocks{false};
+    std::atomic<quint64> m_nextEpoch{0};
+    std::array<Shard, SHARD_COUNT> m_shards;
+    std::atomic<quint64> m_idleEvictions{0};
+    std::atomic<quint64> m_budgetEvictions{0};
+};
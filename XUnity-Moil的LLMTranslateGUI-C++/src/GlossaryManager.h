@@ -1,11 +1,19 @@
 #pragma once
 #include <QString>
-#include <QMap>
-#include <QReadWriteLock>
-#include <QFile>
-#include <QTextStream>
-#include <QFileInfo>
+#include <QHash>
+#include <QDeadlineTimer>
 #include <QDebug>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "AhoCorasick.h"
+#include "CompiledGlossary.h"
+#include "GlossaryWriter.h"
+#include "TokenManager.h"
 
 // 术语表管理器类，负责加载、查询和更新翻译术语
 // GlossaryManager class, responsible for loading, querying, and updating translation terms
@@ -18,53 +26,90 @@ public:
         return instance;
     }
 
-    // 设置文件路径并加载术语
-    // Set file path and load terms
+    // 设置文件路径并加载术语；加载在后台写入线程上进行，调用方 (界面线程) 不等待
+    // Set file path and load terms; the load runs on the background writer thread, the caller (GUI thread) does not wait
     void setFilePath(const QString& path) {
-        // 使用写锁，确保在加载过程中独占访问
-        // Use write lock to ensure exclusive access during loading
-        QWriteLocker locker(&m_lock);
-        m_filePath = path;
-        loadTerms();
+        // 排在此前学到的术语之后，重新编译时文件中已包含它们
+        // Queued behind the terms learned so far, so the file already holds them when it is recompiled
+        m_writer.post([this, path] { reload(path); });
     }
 
     // 获取当前上下文相关的术语 (RAG 核心功能)
+    // 按特异性 (最长匹配优先，丢弃被覆盖的短术语) 排序、同长度按出现频率排序，并截断到 tokenBudget (0 表示不限)
     // Get terms relevant to the current context (RAG Core function)
-    QString getContextPrompt(const QString& text) {
-        // 使用读锁，允许多个线程同时查询
-        // Use read lock to allow multiple threads to query simultaneously
-        QReadLocker locker(&m_lock);
-        if (m_terms.isEmpty()) return "";
+    // Ranked by specificity (longest match wins, overlapped shorter terms dropped), then by how often
+    // the term occurs in requests, and cut off at tokenBudget (0 = unlimited)
+    QString getContextPrompt(const QString& text, int tokenBudget = 0) {
+        // 一次原子读取拿到不可变快照，多个线程可同时查询且互不阻塞
+        // One atomic load yields an immutable snapshot; any number of threads query without blocking
+        const View view(snapshot());
+        if (view.termCount() == 0) return "";
 
-        QStringList foundTerms;
-        // 简单遍历匹配 (对于几千条数据，C++ 处理极快)
-        // Simple iteration match (C++ handles thousands of entries very quickly)
-        QMapIterator<QString, QString> i(m_terms);
-        while (i.hasNext()) {
-            i.next();
-            // 如果原文包含这个 Key (不区分大小写)
-            // If the original text contains this Key (case-insensitive)
-            if (text.contains(i.key(), Qt::CaseInsensitive)) {
-                // 将匹配到的术语格式化为 "原文 = 译文"
-                // Format the matched term as "Original = Translated"
-                foundTerms << (i.key() + " = " + i.value());
-            }
+        std::vector<int> ranked = selectTerms(view, text);
+        if (ranked.empty()) return "";
+
+        // 先按出现次数计数 (不论是否被注入)，排序不会因注入而自我强化
+        // Count occurrences first, injected or not, so the ranking does not reinforce itself
+        std::vector<quint32> usage(ranked.size());
+        for (size_t i = 0; i < ranked.size(); ++i) {
+            usage[i] = view.usage(ranked[i]).fetch_add(1, std::memory_order_relaxed);
         }
 
+        // 更长 (更具体) 的优先；同长度时出现更频繁的优先
+        // Longer (more specific) first; at equal length the more frequent term first
+        std::vector<size_t> order(ranked.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            qsizetype la = view.keyAt(ranked[a]).size();
+            qsizetype lb = view.keyAt(ranked[b]).size();
+            if (la != lb) return la > lb;
+            return usage[a] > usage[b];
+        });
+
+        const QString header = "【已知术语/Known Terms】:\n";
+        long long tokens = TokenManager::estimateTokens(header);
+        QStringList foundTerms;
+        for (size_t i : order) {
+            const int id = ranked[i];
+            // 将匹配到的术语格式化为 "原文 = 译文"
+            // Format the matched term as "Original = Translated"
+            QString line = view.keyAt(id).toString() + " = " + view.valueAt(id).toString();
+            long long cost = TokenManager::estimateTokens(line) + 1;
+            // 超出预算即截断，排在后面的都是较短或较少出现的术语
+            // Stop at the budget; everything after this is shorter or occurs less often
+            if (tokenBudget > 0 && tokens + cost > tokenBudget) break;
+            tokens += cost;
+            foundTerms << line;
+        }
         if (foundTerms.isEmpty()) return "";
         
         // 返回格式化的术语表提示词
         // Return the formatted glossary prompt
-        return "【已知术语/Known Terms】:\n" + foundTerms.join("\n") + "\n";
+        return header + foundTerms.join("\n") + "\n";
+    }
+
+    // 原文包含的全部术语 (按 Key 排序，不排名、不截断、不计频率)，用于缓存键
+    // Every term contained in the text (key-sorted, not ranked, budgeted or counted), for cache keys
+    QString getMatchedTerms(const QString& text) {
+        const View view(snapshot());
+        if (view.termCount() == 0) return "";
+
+        std::vector<int> ids;
+        std::vector<bool> seen(view.termCount(), false);
+        for (const AhoCorasick::Match& m : view.findAll(text)) {
+            if (seen[m.id]) continue;
+            seen[m.id] = true;
+            ids.push_back(m.id);
+        }
+        std::sort(ids.begin(), ids.end(), [&view](int a, int b) { return view.keyAt(a) < view.keyAt(b); });
+        QStringList lines;
+        for (int id : ids) lines << (view.keyAt(id).toString() + " = " + view.valueAt(id).toString());
+        return lines.join("\n");
     }
 
     // 添加新术语 (自进化/学习核心)
     // Add new term (Self-evolution/learning Core)
     void addNewTerm(const QString& key, const QString& value) {
-        // 需要修改数据，使用写锁
-        // Need to modify data, use write lock
-        QWriteLocker locker(&m_lock);
-        
         // 基础过滤：防止脏数据
         // Basic filtering: Prevent dirty data
         
@@ -72,10 +117,6 @@ public:
         // Length check: Key at least 2 chars, Value at least 1 char
         if (key.length() < 2 || value.length() < 1) return;
         
-        // 防止重复添加
-        // Prevent duplicate additions
-        if (m_terms.contains(key)) return; 
-        
         // 格式检查：防止包含等号，破坏文件格式
         // Format check: Prevent containing equals sign, which breaks file format
         if (key.contains("=") || value.contains("=")) return; 
@@ -84,64 +125,224 @@ public:
         // Prevent containing newlines
         if (key.contains("\n") || value.contains("\n")) return;
 
-        // 更新内存中的 Map
-        // Update the Map in memory
-        m_terms.insert(key, value);
-        // 追加写入到文件
-        // Append to file
-        appendToFile(key, value);
+        // 只与其他写入者互斥；读者不受影响，继续使用旧快照
+        // Exclusive only against other writers; readers keep using the previous snapshot
+        std::lock_guard<std::mutex> writerLock(m_writeMutex);
+        std::shared_ptr<const Snapshot> current = snapshot();
+
+        // 防止重复添加
+        // Prevent duplicate additions
+        if (current->base->image.indexOf(key) >= 0 || current->overlay->index.contains(key)) return; 
+
+        // 复制增量层并加入新术语，与原基础表组成新快照后原子发布，读者立即可见
+        // Copy the overlay, add the term, pair it with the same base and publish; readers see it at once
+        auto overlay = std::make_shared<Overlay>(*current->overlay);
+        overlay->index.insert(key, int(overlay->keys.size()));
+        overlay->keys << key;
+        overlay->values << value;
+        overlay->usage.push_back(std::make_shared<std::atomic<quint32>>(0));
+        overlay->matcher.insert(key);
+        auto next = std::make_shared<Snapshot>();
+        next->base = current->base;
+        next->overlay = std::move(overlay);
+        publish(std::move(next));
+
+        // 由后台线程批量追加写入文件
+        // Appended to the file in batches by the background writer
+        m_writer.enqueue(key, value);
     }
 
 private:
+    // 等待旧基础表被释放的最长时间 (毫秒) / Longest wait for the old base to be released (ms)
+    static constexpr int RELEASE_WAIT_MS = 2000;
+
+    // 本次运行学到的新术语 (增量层)，编号 = 基础表术语数 + 下标；发布后不再修改
+    // Terms learned during this run (overlay), id = base term count + index; immutable once published
+    struct Overlay {
+        QStringList keys;
+        QStringList values;
+        QHash<QString, int> index;
+        AhoCorasick matcher;
+        // 副本之间共享计数器，发布新版本不会丢失计数 / Counters are shared between copies, so republishing keeps them
+        std::vector<std::shared_ptr<std::atomic<quint32>>> usage;
+    };
+
+    // 已编译的基础表及其使用计数，随快照共享，最后一个读者释放时解除映射
+    // The compiled base and its usage counts, shared between snapshots; unmapped when the last reader lets go
+    struct Base {
+        CompiledGlossary image;
+        std::unique_ptr<std::atomic<quint32>[]> usage;
+    };
+
+    // 发布后不再修改的完整术语表状态 / Complete glossary state, immutable once published
+    struct Snapshot {
+        std::shared_ptr<const Base> base;
+        std::shared_ptr<const Overlay> overlay;
+    };
+
+    // 读者看到的一致视图：持有快照，保证其中的数据在查询期间有效
+    // Consistent view for a reader: holds the snapshot so its data stays valid during the query
+    struct View {
+        explicit View(std::shared_ptr<const Snapshot> s)
+            : snapshot(std::move(s)), base(snapshot->base->image), baseUsage(snapshot->base->usage.get()),
+              overlay(snapshot->overlay.get()) {}
+
+        std::shared_ptr<const Snapshot> snapshot;
+        const CompiledGlossary& base;
+        std::atomic<quint32>* baseUsage;
+        const Overlay* overlay;
+
+        // 术语编号：先是已编译的基础表，其后是运行时学到的增量层
+        // Term ids: the compiled base first, then the overlay learned at runtime
+        int termCount() const { return base.termCount() + int(overlay->keys.size()); }
+
+        QStringView keyAt(int id) const {
+            int baseCount = base.termCount();
+            return id < baseCount ? base.key(id) : QStringView(overlay->keys[id - baseCount]);
+        }
+
+        QStringView valueAt(int id) const {
+            int baseCount = base.termCount();
+            return id < baseCount ? base.value(id) : QStringView(overlay->values[id - baseCount]);
+        }
+
+        std::atomic<quint32>& usage(int id) const {
+            int baseCount = base.termCount();
+            return id < baseCount ? baseUsage[id] : *overlay->usage[id - baseCount];
+        }
+
+        // 在基础表与增量层中查找，增量层的编号接在基础表之后
+        // Search the base and the overlay; overlay ids follow the base ids
+        std::vector<AhoCorasick::Match> findAll(const QString& text) const {
+            std::vector<AhoCorasick::Match> matches = base.findAll(text);
+            if (!overlay->keys.isEmpty()) {
+                const int baseCount = base.termCount();
+                for (AhoCorasick::Match m : overlay->matcher.findAll(text)) {
+                    m.id += baseCount;
+                    matches.push_back(m);
+                }
+            }
+            return matches;
+        }
+    };
+
+    std::shared_ptr<const Snapshot> snapshot() const {
+        return std::atomic_load(&m_snapshot);
+    }
+
+    void publish(std::shared_ptr<const Snapshot> next) {
+        std::atomic_store(&m_snapshot, std::move(next));
+    }
+
+    // 找出原文中的术语，最长匹配优先：与已选的更长术语重叠的出现位置被丢弃
+    // Find the terms in the text, longest match first: occurrences overlapping a longer chosen term are dropped
+    static std::vector<int> selectTerms(const View& view, const QString& text) {
+        std::vector<AhoCorasick::Match> matches = view.findAll(text);
+        std::sort(matches.begin(), matches.end(), [](const AhoCorasick::Match& a, const AhoCorasick::Match& b) {
+            if (a.length != b.length) return a.length > b.length;
+            return a.start < b.start;
+        });
+
+        std::vector<bool> covered(text.size(), false);
+        std::vector<bool> chosen(view.termCount(), false);
+        std::vector<int> result;
+        for (const AhoCorasick::Match& m : matches) {
+            bool overlaps = false;
+            for (int k = m.start; k < m.start + m.length && !overlaps; ++k) overlaps = covered[k];
+            if (overlaps) continue;
+            for (int k = m.start; k < m.start + m.length; ++k) covered[k] = true;
+            if (!chosen[m.id]) {
+                chosen[m.id] = true;
+                result.push_back(m.id);
+            }
+        }
+        return result;
+    }
+
     // 私有构造函数 (单例模式)
     // Private constructor (Singleton pattern)
-    GlossaryManager() {}
+    GlossaryManager() {
+        auto empty = std::make_shared<Snapshot>();
+        empty->base = std::make_shared<Base>();
+        empty->overlay = std::make_shared<Overlay>();
+        m_snapshot = std::move(empty);
+    }
     
-    // 从文件加载术语到内存
-    // Load terms from file into memory
-    void loadTerms() {
-        m_terms.clear();
-        if (m_filePath.isEmpty()) return;
-
-        QFile file(m_filePath);
-        if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            QTextStream in(&file);
-            in.setEncoding(QStringConverter::Utf8); // 假设文件是 UTF-8 / Assume file is UTF-8
-            while (!in.atEnd()) {
-                QString line = in.readLine();
-                // XUnity 格式通常是 Original=Translated
-                // XUnity format is typically Original=Translated
-                int idx = line.indexOf('=');
-                if (idx > 0) {
-                    QString key = line.left(idx).trimmed();
-                    QString val = line.mid(idx + 1).trimmed();
-                    // 确保键值都不为空
-                    // Ensure both key and value are not empty
-                    if (!key.isEmpty() && !val.isEmpty()) {
-                        m_terms.insert(key, val);
-                    }
+    // 在写入线程上重新加载：编译期间不持锁，读者与 addNewTerm 继续使用旧快照
+    // Reload on the writer thread: no lock while compiling, readers and addNewTerm keep using the old snapshot
+    void reload(const QString& path) {
+        std::shared_ptr<const Base> base = loadBase(path);
+
+        std::weak_ptr<const Base> previous;
+        {
+            std::lock_guard<std::mutex> writerLock(m_writeMutex);
+            std::shared_ptr<const Snapshot> current = snapshot();
+            previous = current->base;
+            auto next = std::make_shared<Snapshot>();
+            next->base = base;
+            auto overlay = std::make_shared<Overlay>();
+            // 同一文件：编译之后才写入的术语不在新基础表中，保留在增量层
+            // Same file: terms written after it was compiled are not in the new base, keep them in the overlay
+            if (path == m_writer.filePath()) {
+                const Overlay& old = *current->overlay;
+                for (int i = 0; i < old.keys.size(); ++i) {
+                    if (base->image.indexOf(old.keys[i]) >= 0) continue;
+                    overlay->index.insert(old.keys[i], int(overlay->keys.size()));
+                    overlay->keys << old.keys[i];
+                    overlay->values << old.values[i];
+                    overlay->usage.push_back(old.usage[size_t(i)]);
+                    overlay->matcher.insert(old.keys[i]);
                 }
             }
+            next->overlay = std::move(overlay);
+            publish(std::move(next));
+            // 此后学到的术语写入新文件 / Terms learned from now on go to the new file
+            m_writer.setFilePath(path);
         }
+
+        // 新编译的术语表：等旧基础表随最后一个读者释放 (解除对旧伴随文件的映射) 后再写出伴随文件，
+        // Windows 下无法替换仍被映射的文件
+        // Freshly compiled: write the sidecar only after the old base was released with its last
+        // reader (unmapping the old sidecar); Windows cannot replace a file that is still mapped
+        if (base->image.needsSave()) {
+            if (waitReleased(previous)) base->image.saveSidecar();
+            else qWarning() << "Previous glossary still in use, sidecar not saved this time";
+        }
+    }
+
+    // 读者只在单次查询期间持有快照，因此旧基础表很快就会被释放；超时返回 false
+    // Readers hold a snapshot for a single query only, so the old base goes away quickly; false on timeout
+    static bool waitReleased(const std::weak_ptr<const Base>& previous) {
+        QDeadlineTimer deadline(RELEASE_WAIT_MS);
+        while (!previous.expired()) {
+            if (deadline.hasExpired()) return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
     }
 
-    // 将单个术语追加到文件末尾
-    // Append a single term to the end of the file
-    void appendToFile(const QString& key, const QString& value) {
-        if (m_filePath.isEmpty()) return;
-        QFile file(m_filePath);
-        // 以追加模式打开文件
-        // Open file in append mode
-        if (file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
-            QTextStream out(&file);
-            out.setEncoding(QStringConverter::Utf8);
-            out << key << "=" << value << "\n";
+    // 加载术语：映射已编译的伴随文件，源文件改动后才重新编译
+    // Load terms: map the compiled sidecar, recompiled only after the source file changed
+    static std::shared_ptr<const Base> loadBase(const QString& path) {
+        auto base = std::make_shared<Base>();
+        if (path.isEmpty()) return base;
+
+        if (!base->image.open(path)) {
+            qWarning() << "Failed to load glossary:" << path;
+            return base;
         }
+        qDebug() << "Glossary loaded:" << base->image.termCount() << "terms"
+                 << (base->image.loadedFromCache() ? "(mapped)" : "(compiled)");
+        base->usage.reset(new std::atomic<quint32>[size_t(base->image.termCount())]());
+        return base;
     }
 
-    QString m_filePath;
-    QMap<QString, QString> m_terms;
-    // 读写锁，保护 m_terms 和文件写入操作
-    // Read-write lock to protect m_terms and file write operations
-    mutable QReadWriteLock m_lock;
-};
\ No newline at end of file
+    // 当前发布的快照 (通过 std::atomic_load/atomic_store 无锁读取与替换)
+    // Currently published snapshot (read and replaced lock-free with std::atomic_load/atomic_store)
+    std::shared_ptr<const Snapshot> m_snapshot;
+    // 串行化快照的发布者 (新增术语与重新加载)，从不在持有期间等待
+    // Serializes snapshot publishers (new terms and reloads); never held while waiting
+    std::mutex m_writeMutex;
+    // 后台追加写入器 / Background append writer
+    GlossaryWriter m_writer;
+};
@@ -0,0 +1,122 @@
+#include "GlossaryWriter.h"
+#include <QFile>
+#include <QDebug>
+#include <chrono>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+GlossaryWriter::GlossaryWriter() {
+    m_thread = std::thread(&GlossaryWriter::run, this);
+}
+
+GlossaryWriter::~GlossaryWriter() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) m_thread.join(); // run() drains the queue before exiting / run() 退出前会写完队列
+}
+
+void GlossaryWriter::setFilePath(const QString& path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_filePath = path;
+}
+
+QString GlossaryWriter::filePath() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_filePath;
+}
+
+void GlossaryWriter::post(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stop) return;
+        m_tasks.push_back(std::move(task));
+    }
+    m_cv.notify_all();
+}
+
+void GlossaryWriter::enqueue(const QString& key, const QString& value) {
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_filePath.isEmpty()) return;
+        m_pending.append({m_filePath, key + "=" + value});
+        ++m_enqueued;
+        wake = m_pending.size() == 1 || m_pending.size() >= FLUSH_BATCH_SIZE;
+    }
+    // The first term starts the flush timer, a full batch flushes at once
+    // 第一条术语启动计时，攒满一批则立即写出
+    if (wake) m_cv.notify_all();
+}
+
+void GlossaryWriter::flush() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_written == m_enqueued) return;
+    const quint64 target = m_enqueued;
+    m_flushRequested = true;
+    m_cv.notify_all();
+    m_doneCv.wait(lock, [this, target] { return m_written >= target || m_stop; });
+}
+
+void GlossaryWriter::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_cv.wait(lock, [this] { return m_stop || !m_pending.isEmpty() || !m_tasks.empty(); });
+        if (m_stop) m_tasks.clear(); // No reloads while shutting down / 关闭期间不再重新加载
+        if (m_pending.isEmpty() && m_tasks.empty()) break; // Stopping with nothing left / 停止且队列已空
+
+        // Give later terms a chance to join the same write; a waiting task writes at once
+        // 等待后续术语加入同一次写入；有任务等待时立即写出
+        m_cv.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL_MS), [this] {
+            return m_stop || m_flushRequested || !m_tasks.empty() || m_pending.size() >= FLUSH_BATCH_SIZE;
+        });
+
+        QVector<QPair<QString, QString>> batch;
+        batch.swap(m_pending);
+        std::vector<std::function<void()>> tasks;
+        if (!m_stop) tasks.swap(m_tasks);
+        m_flushRequested = false;
+
+        lock.unlock();
+        writeAll(batch);
+        for (auto& task : tasks) task();
+        lock.lock();
+
+        m_written += quint64(batch.size());
+        if (m_written == m_enqueued) m_flushRequested = false;
+        m_doneCv.notify_all();
+    }
+}
+
+void GlossaryWriter::writeAll(const QVector<QPair<QString, QString>>& batch) {
+    for (int i = 0; i < batch.size();) {
+        const QString& path = batch[i].first;
+        QStringList lines;
+        for (; i < batch.size() && batch[i].first == path; ++i) lines << batch[i].second;
+        if (!writeBatch(path, lines)) {
+            qWarning() << "Failed to append" << lines.size() << "glossary terms to" << path;
+        }
+    }
+}
+
+bool GlossaryWriter::writeBatch(const QString& path, const QStringList& lines) {
+    QFile file(path);
+    // 以追加模式打开文件
+    // Open file in append mode
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) return false;
+    QByteArray data = (lines.join("\n") + "\n").toUtf8();
+    if (file.write(data) != data.size() || !file.flush()) return false;
+
+    // Push the OS cache to the disk so learned terms survive a crash / 将系统缓存刷到磁盘，崩溃后术语不丢失
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QPair>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief Background Glossary Append Writer
+ * @brief 术语表后台追加写入器
+ *
+ * Learned terms are queued and appended to the glossary file by a background thread,
+ * so the request threads never wait on disk I/O. Terms that arrive close together are
+ * coalesced into one write, which is followed by an fsync.
+ * 学到的新术语先入队，由后台线程追加写入术语表文件，请求线程不会等待磁盘 I/O。
+ * 相近时间到达的术语合并为一次写入，写入后执行 fsync。
+ *
+ * The same thread also runs posted tasks (glossary reloads), after the terms queued before them.
+ * 同一线程还负责执行投递的任务 (重新加载术语表)，排在其之前入队的术语写完后才执行。
+ */
+class GlossaryWriter {
+public:
+    GlossaryWriter();
+    ~GlossaryWriter();
+    GlossaryWriter(const GlossaryWriter&) = delete;
+    GlossaryWriter& operator=(const GlossaryWriter&) = delete;
+
+    // Switch to another file without waiting; terms already queued still go to the old one
+    // 切换到另一个文件且不等待；已排队的术语仍写入旧文件
+    void setFilePath(const QString& path);
+    QString filePath();
+
+    // Run task on the writer thread once the terms queued so far are written; dropped on shutdown
+    // 在写入线程上执行任务 (先写完此前排队的术语)；关闭时未执行的任务被丢弃
+    void post(std::function<void()> task);
+
+    // Queue one "key=value" line / 将一行 "key=value" 加入队列
+    void enqueue(const QString& key, const QString& value);
+
+    // Write everything queued so far and wait until it is on disk
+    // 写出目前所有排队的术语，并等待其落盘
+    void flush();
+
+private:
+    // Flush at the latest this long after the first queued term / 第一条术语入队后最迟多久写出
+    static constexpr int FLUSH_INTERVAL_MS = 1000;
+    // Flush early once this many terms are queued / 排队数量达到此值时提前写出
+    static constexpr int FLUSH_BATCH_SIZE = 64;
+
+    void run();
+    // Append lines to path and fsync it / 将若干行追加到文件并 fsync
+    static bool writeBatch(const QString& path, const QStringList& lines);
+    // Write lines grouped by their target file / 按目标文件分组写出
+    static void writeAll(const QVector<QPair<QString, QString>>& batch);
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;      // Wakes the writer / 唤醒写入线程
+    std::condition_variable m_doneCv;  // Signals a finished write / 通知一次写入完成
+    QString m_filePath;
+    QVector<QPair<QString, QString>> m_pending; // (File, line) / (文件, 行)
+    std::vector<std::function<void()>> m_tasks;
+    quint64 m_enqueued = 0; // Terms queued so far / 累计入队数
+    quint64 m_written = 0;  // Terms written (or given up on) so far / 累计已写出 (或放弃) 数
+    bool m_flushRequested = false;
+    bool m_stop = false;
+    std::thread m_thread;
+};
@@ -0,0 +1,149 @@
+#include "JsonWriter.h"
+#include <QLocale>
+#include <cmath>
+#include <cstring>
+
+JsonWriter& JsonWriter::forThread() {
+    thread_local JsonWriter writer;
+    writer.clear();
+    return writer;
+}
+
+void JsonWriter::clear() {
+    // resize(0) keeps the capacity, clear() would free it / resize(0) 保留容量，clear() 会释放内存
+    m_buffer.resize(0);
+    m_first.clear();
+    m_afterKey = false;
+}
+
+void JsonWriter::separate() {
+    if (m_afterKey) {
+        m_afterKey = false;
+        return;
+    }
+    if (m_first.empty()) return;
+    if (m_first.back()) m_first.back() = false;
+    else m_buffer.append(',');
+}
+
+void JsonWriter::beginObject() {
+    separate();
+    m_buffer.append('{');
+    m_first.push_back(true);
+}
+
+void JsonWriter::endObject() {
+    m_buffer.append('}');
+    m_first.pop_back();
+}
+
+void JsonWriter::beginArray() {
+    separate();
+    m_buffer.append('[');
+    m_first.push_back(true);
+}
+
+void JsonWriter::endArray() {
+    m_buffer.append(']');
+    m_first.pop_back();
+}
+
+void JsonWriter::key(const char* name) {
+    separate();
+    m_buffer.append('"').append(name).append("\":");
+    m_afterKey = true;
+}
+
+void JsonWriter::value(QStringView text) {
+    separate();
+    writeString(text);
+}
+
+void JsonWriter::value(const char* ascii) {
+    separate();
+    m_buffer.append('"').append(ascii).append('"');
+}
+
+void JsonWriter::value(double number) {
+    separate();
+    // JSON has no NaN / Infinity / JSON 不支持 NaN 与 Infinity
+    if (!std::isfinite(number)) {
+        m_buffer.append("null");
+        return;
+    }
+    m_buffer.append(QByteArray::number(number, 'g', QLocale::FloatingPointShortest));
+}
+
+void JsonWriter::value(int number) {
+    separate();
+    m_buffer.append(QByteArray::number(number));
+}
+
+void JsonWriter::value(bool flag) {
+    separate();
+    m_buffer.append(flag ? "true" : "false");
+}
+
+/**
+ * @brief Writes a quoted JSON string, converting UTF-16 to UTF-8 on the fly
+ * @brief 写入带引号的 JSON 字符串，同时将 UTF-16 转换为 UTF-8
+ * @details Unpaired surrogates become U+FFFD, as in QString::toUtf8()
+ * @details 不成对的代理项替换为 U+FFFD，与 QString::toUtf8() 一致
+ */
+void JsonWriter::writeString(QStringView text) {
+    // Worst case 6 bytes per UTF-16 unit ("\u001f"), plus the quotes / 最坏情况每个 UTF-16 单元 6 字节，再加引号
+    const qsizetype start = m_buffer.size();
+    m_buffer.resize(start + text.size() * 6 + 2);
+    char* out = m_buffer.data() + start;
+    static const char hex[] = "0123456789abcdef";
+
+    *out++ = '"';
+    const char16_t* p = text.utf16();
+    const char16_t* end = p + text.size();
+    while (p < end) {
+        char32_t c = *p++;
+        if (c < 0x80) {
+            if (c >= 0x20 && c != '"' && c != '\\') {
+                *out++ = char(c);
+                continue;
+            }
+            *out++ = '\\';
+            switch (c) {
+            case '"':  *out++ = '"'; break;
+            case '\\': *out++ = '\\'; break;
+            case '\b': *out++ = 'b'; break;
+            case '\f': *out++ = 'f'; break;
+            case '\n': *out++ = 'n'; break;
+            case '\r': *out++ = 'r'; break;
+            case '\t': *out++ = 't'; break;
+            default:
+                std::memcpy(out, "u00", 3);
+                out += 3;
+                *out++ = hex[c >> 4];
+                *out++ = hex[c & 0xF];
+                break;
+            }
+        } else if (c < 0x800) {
+            *out++ = char(0xC0 | (c >> 6));
+            *out++ = char(0x80 | (c & 0x3F));
+        } else {
+            if (c >= 0xD800 && c <= 0xDFFF) {
+                // A high surrogate followed by a low one forms one code point / 高代理项后接低代理项组成一个码点
+                if (c <= 0xDBFF && p < end && *p >= 0xDC00 && *p <= 0xDFFF) {
+                    c = 0x10000 + ((c - 0xD800) << 10) + (char32_t(*p++) - 0xDC00);
+                    *out++ = char(0xF0 | (c >> 18));
+                    *out++ = char(0x80 | ((c >> 12) & 0x3F));
+                    *out++ = char(0x80 | ((c >> 6) & 0x3F));
+                    *out++ = char(0x80 | (c & 0x3F));
+                    continue;
+                }
+                c = 0xFFFD;
+            }
+            *out++ = char(0xE0 | (c >> 12));
+            *out++ = char(0x80 | ((c >> 6) & 0x3F));
+            *out++ = char(0x80 | (c & 0x3F));
+        }
+    }
+    *out++ = '"';
+    m_buffer.resize(out - m_buffer.constData());
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <QStringView>
+#include <vector>
+
+/**
+ * @brief Streaming JSON Writer for Request Payloads
+ * @brief 用于请求负载的流式 JSON 写入器
+ *
+ * Writes JSON text straight into a byte buffer, without building a document tree first.
+ * Strings are converted from UTF-16 to UTF-8 and escaped in the same pass, so a QString
+ * never goes through toStdString(). Each thread reuses one buffer, whose capacity stays
+ * allocated between requests.
+ * 直接将 JSON 文本写入字节缓冲区，不先构建文档树。字符串在同一遍扫描中完成 UTF-16 到 UTF-8
+ * 的转换与转义，QString 无需经过 toStdString()。每个线程复用一个缓冲区，其容量在请求之间保留。
+ *
+ * The caller is responsible for well-formed nesting (every begin has its end, a key before
+ * each value inside an object).
+ * 调用方需保证嵌套正确 (每个 begin 都有对应的 end，对象中的每个值之前都有键)。
+ */
+class JsonWriter {
+public:
+    // Empty writer of the calling thread / 当前线程的写入器 (已清空)
+    static JsonWriter& forThread();
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+
+    // Object key; names are plain ASCII literals in this code base / 对象键；本项目中键名均为 ASCII 字面量
+    void key(const char* name);
+
+    void value(QStringView text);
+    void value(const char* ascii);
+    void value(double number);
+    void value(int number);
+    void value(bool flag);
+
+    // Deep copy of the written bytes (the buffer itself stays with the thread)
+    // 已写入字节的深拷贝 (缓冲区本身留给当前线程继续使用)
+    QByteArray toByteArray() const { return QByteArray(m_buffer.constData(), m_buffer.size()); }
+
+private:
+    JsonWriter() = default;
+
+    void clear();
+    // Comma before every element but the first / 除第一个元素外，每个元素前写逗号
+    void separate();
+    void writeString(QStringView text);
+
+    QByteArray m_buffer;
+    std::vector<bool> m_first; // One flag per open object/array / 每个未闭合的对象/数组一个标志
+    bool m_afterKey = false;
+};
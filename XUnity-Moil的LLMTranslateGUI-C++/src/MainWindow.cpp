@@ -49,9 +49,22 @@ const char* STR_THEME_DARK[] = {"切换暗色", "Dark Mode"};
 const char* STR_LANG_BTN[] = {"English", "中文"}; 
 const char* STR_GLOSSARY[] = {"术语表:", "Glossary:"}; 
 const char* STR_CHK_GLOSSARY[] = {"启用自进化 (实验性)", "Enable Self-Evolution (Exp)"};
+const char* STR_CACHE[] = {"缓存:", "Cache:"};
+const char* STR_CHK_CACHE[] = {"启用持久化翻译缓存", "Enable Persistent Translation Cache"};
 const char* STR_CLEAR_LOG[] = {"清空日志", "Clear Log"};
+const char* STR_SHOW_STATS[] = {"显示统计", "Show Stats"};
 const char* STR_TOKENS[] = {"消耗:", "Tokens:"};
 const char* TIP_TOKENS[] = {"本次运行总消耗 (输入+输出)", "Total Usage (Prompt + Completion)"};
+// 熔断器状态，以 CircuitBreaker::State 为下标 / Circuit breaker state, indexed by CircuitBreaker::State
+const char* STR_CIRCUIT[][2] = {
+    {"上游: 正常", "Upstream: OK"},
+    {"上游: 已熔断", "Upstream: Circuit Open"},
+    {"上游: 探测中", "Upstream: Probing"}
+};
+const char* TIP_CIRCUIT[] = {
+    "API 持续失败时熔断器打开，请求直接返回 503，冷却后自动探测恢复",
+    "When the API keeps failing the circuit opens and requests get 503 at once; it probes for recovery after a cool-off"
+};
 // ==========================================
 // 📝 多语言字典定义 (日志文本)
 // 📝 Multi-language Dictionary Definitions (Log Text)
@@ -88,6 +101,10 @@ const char* TIP_GLOSSARY[] = {
     "选择 XUnity 的 _Substitutions.txt 文件。\nLLM 将自动参考并补充该文件。",
     "Select XUnity's _Substitutions.txt.\nLLM will reference and append to it."
 };
+const char* TIP_CACHE[] = {
+    "已翻译过的文本直接从磁盘缓存返回，重启后仍然有效。\n缓存文件路径可在 config.ini 的 cache_path 中修改。",
+    "Previously translated text is answered from a disk cache that survives restarts.\nThe file location is set by cache_path in config.ini."
+};
 
 /**
  * 构造函数：初始化主窗口
@@ -138,6 +155,9 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     // Display flow: TokenManager -> UI
     connect(m_tokenManager, &TokenManager::tokensUpdated, this, &MainWindow::updateTokenDisplay);
 
+    // 熔断器状态 -> UI / Circuit breaker state -> UI
+    connect(server, &TranslationServer::circuitStateChanged, this, &MainWindow::onCircuitStateChanged);
+
     // ============================================================
     // 第四阶段：初始化状态 (State Initialization)
     // Phase 4: Initialize State
@@ -298,6 +318,8 @@ void MainWindow::updateUIText() {
     
     lblGlossary->setText(STR_GLOSSARY[i]);
     chkGlossary->setText(STR_CHK_GLOSSARY[i]);
+    lblCache->setText(STR_CACHE[i]);
+    chkCache->setText(STR_CHK_CACHE[i]);
     
     startBtn->setText(STR_START[i]);
     stopBtn->setText(STR_STOP[i]);
@@ -320,6 +342,8 @@ lblGlossary->setToolTip(TIP_GLOSSARY[i]);
     chkGlossary->setToolTip(TIP_GLOSSARY[i]);
     glossaryPathEdit->setToolTip(TIP_GLOSSARY[i]);
     btnSelectGlossary->setToolTip(TIP_GLOSSARY[i]);
+    lblCache->setToolTip(TIP_CACHE[i]);
+    chkCache->setToolTip(TIP_CACHE[i]);
 
     // ✅ 自信的代码：直接调用，无需判空
     // ✅ Confident code: Call directly without null checks
@@ -327,6 +351,8 @@ lblGlossary->setToolTip(TIP_GLOSSARY[i]);
     // Because according to the constructor order, lblTokens must be alive when running here
     lblTokens->setText(QString("%1 %2").arg(STR_TOKENS[i]).arg(m_tokenManager->getTotal()));
     lblTokens->setToolTip(TIP_TOKENS[i]);
+    lblCircuit->setText(STR_CIRCUIT[m_circuitState][i]);
+    lblCircuit->setToolTip(TIP_CIRCUIT[i]);
 }
 
 /**
@@ -467,6 +493,10 @@ void MainWindow::setupUi() {
     lblTokens = new QLabel(this);
     lblTokens->setStyleSheet("color: #DAA520; font-weight: bold;"); 
 
+    // 上游熔断状态 / Upstream circuit state
+    lblCircuit = new QLabel(this);
+    lblCircuit->setStyleSheet("color: #2E8B57; font-weight: bold;");
+
     // 添加到布局 / Add to layout
     paramLayout->addWidget(lblPort);
     paramLayout->addWidget(portEdit);
@@ -483,6 +513,8 @@ void MainWindow::setupUi() {
     // 添加 Tokens 消耗器 / Add Tokens consumption display
     paramLayout->addSpacing(15);
     paramLayout->addWidget(lblTokens);
+    paramLayout->addSpacing(15);
+    paramLayout->addWidget(lblCircuit);
 
     paramLayout->addStretch(); // 弹簧，保持左对齐 / Spring to keep left alignment
 
@@ -517,6 +549,11 @@ void MainWindow::setupUi() {
     glossaryLayout->addWidget(btnSelectGlossary);
     grid->addWidget(createLabel(lblGlossary), 6, 0);
     grid->addWidget(glossaryContainer, 6, 1);
+
+    // Row 7: Translation Cache
+    chkCache = new QCheckBox(this);
+    grid->addWidget(createLabel(lblCache), 7, 0);
+    grid->addWidget(chkCache, 7, 1);
     
     mainLayout->addWidget(cfgGroup);
 
@@ -575,6 +612,13 @@ void MainWindow::onLogContextMenu(const QPoint &pos) {
     // 4. 连接动作到 logArea 的 clear 槽函数
     // 4. Connect action to logArea's clear slot
     connect(clearAction, &QAction::triggered, logArea, &QTextEdit::clear);
+
+    // 添加“显示统计”动作，把服务端计数输出到日志
+    // Add "Show Stats" action that prints server counters to the log
+    QAction *statsAction = menu->addAction(STR_SHOW_STATS[m_currentLang]);
+    connect(statsAction, &QAction::triggered, this, [this]() {
+        logArea->append(server->statsReport());
+    });
     
     // 5. 在鼠标位置显示菜单
     // 5. Show menu at mouse position
@@ -603,7 +647,9 @@ void MainWindow::loadConfigToUi() {
     
     chkGlossary->setChecked(cfg.enable_glossary);
     glossaryPathEdit->setText(cfg.glossary_path);
+    chkCache->setChecked(cfg.enable_cache);
     
+    m_baseConfig = cfg;
     m_currentLang = cfg.language; 
 }
 
@@ -612,7 +658,9 @@ void MainWindow::loadConfigToUi() {
  * Get current configuration from UI controls
  */
 AppConfig MainWindow::getUiConfig() {
-    AppConfig cfg;
+    // 以最近加载的配置为基础，避免丢失界面未暴露的高级项
+    // Start from the last loaded config so advanced options without UI controls are kept
+    AppConfig cfg = m_baseConfig;
     cfg.api_address = apiAddressEdit->text();
     cfg.api_key = apiKeyEdit->text();
     cfg.model_name = modelCombo->currentText();
@@ -625,6 +673,7 @@ AppConfig MainWindow::getUiConfig() {
     
     cfg.enable_glossary = chkGlossary->isChecked();
     cfg.glossary_path = glossaryPathEdit->text();
+    cfg.enable_cache = chkCache->isChecked();
     
     cfg.language = m_currentLang; 
     return cfg;
@@ -645,6 +694,7 @@ void MainWindow::toggleControls(bool running) {
     chkGlossary->setEnabled(!running);
     glossaryPathEdit->setEnabled(!running);
     btnSelectGlossary->setEnabled(!running);
+    chkCache->setEnabled(!running);
 }
 
 /**
@@ -708,6 +758,8 @@ void MainWindow::onLoadConfig() {
         
         chkGlossary->setChecked(cfg.enable_glossary);
         glossaryPathEdit->setText(cfg.glossary_path);
+        chkCache->setChecked(cfg.enable_cache);
+        m_baseConfig = cfg;
         
         logArea->append(QString(LOG_CFG_LOADED[m_currentLang]) + fileName);
     }
@@ -826,4 +878,17 @@ void MainWindow::onTestConfig() {
 void MainWindow::updateTokenDisplay(long long total, long long prompt, long long completion) {
     lblTokens->setText(QString("%1 %2").arg(STR_TOKENS[m_currentLang]).arg(total));
     lblTokens->setToolTip(QString("Input: %1\nOutput: %2").arg(prompt).arg(completion));
+}
+
+/**
+ * 更新上游熔断状态显示
+ * Update upstream circuit breaker display
+ */
+void MainWindow::onCircuitStateChanged(int state) {
+    if (state < 0 || state > 2) return;
+    m_circuitState = state;
+    // 绿色正常 / 红色熔断 / 橙色探测 / Green OK, red open, orange probing
+    static const char* colors[] = {"#2E8B57", "#DC143C", "#FF8C00"};
+    lblCircuit->setStyleSheet(QString("color: %1; font-weight: bold;").arg(colors[state]));
+    lblCircuit->setText(STR_CIRCUIT[state][m_currentLang]);
 }
\ No newline at end of file
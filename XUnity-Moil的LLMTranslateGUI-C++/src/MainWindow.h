@@ -39,6 +39,7 @@ private slots:
     void onLoadConfig();         // 手动加载配置 / Manually load config
     void onExportLog();          // 导出日志到文件 / Export logs to file
     void updateTokenDisplay(long long total, long long prompt, long long completion); // 更新 Token 显示 / Update token display
+    void onCircuitStateChanged(int state); // 更新熔断状态显示 / Update circuit breaker display
 
 
     // 日志接收槽函数 / Log reception slot
@@ -72,6 +73,10 @@ private:
     bool m_isDarkTheme = true;  // 当前是否为深色主题 / Is currently dark theme
     int m_currentLang = 0;      // 当前语言索引 (0: English, 1: Chinese)
 
+    // 最近一次加载的配置，保留界面上没有对应控件的高级项 (仅存在于 config.ini)
+    // Last loaded config, keeps advanced options that have no UI control (config.ini only)
+    AppConfig m_baseConfig;
+
     // UI Components (UI 组件指针)
     QLineEdit *apiAddressEdit;
     QLineEdit *apiKeyEdit;
@@ -89,6 +94,9 @@ private:
     QLineEdit *glossaryPathEdit;  
     QPushButton *btnSelectGlossary; 
 
+    // Cache UI (翻译缓存组件)
+    QCheckBox *chkCache;
+
     // Buttons (控制按钮)
     QPushButton *startBtn;
     QPushButton *stopBtn;
@@ -114,10 +122,13 @@ private:
     QLabel *lblSysPrompt;
     QLabel *lblPrePrompt;
     QLabel *lblGlossary; 
+    QLabel *lblCache;
 
     // 核心逻辑对象 / Core Logic Objects
     TranslationServer *server;
     QPropertyAnimation *fadeAnim; // 窗口透明度动画 / Window opacity animation
     TokenManager *m_tokenManager; 
     QLabel *lblTokens;            // 显示 Token 使用情况的标签 / Label to display token usage
+    QLabel *lblCircuit;           // 显示上游熔断状态的标签 / Label to display upstream circuit state
+    int m_circuitState = 0;       // 当前熔断状态 (CircuitBreaker::State) / Current circuit state
 };
\ No newline at end of file
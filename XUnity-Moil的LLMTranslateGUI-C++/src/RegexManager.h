@@ -8,12 +8,24 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QDebug>
+#include <QCryptographicHash>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include "RegexPass.h"
 
 struct RegexRule {
     QRegularExpression pattern;
     QString replacement;
 };
 
+// 一次加载得到的全部规则 (已编译为执行流水线)，发布后不再修改
+struct RegexRuleSet {
+    RegexPipeline pre;
+    RegexPipeline post;
+    QByteArray digest; // 全部规则 (模式与替换文本) 的摘要，没有规则时为空；参与翻译缓存键的计算
+};
+
 class RegexManager {
 public:
     static RegexManager& instance() {
@@ -22,36 +34,85 @@ public:
     }
 
     // 根据 _Substitutions.txt 的路径，自动寻找同级目录下的正则文件
-    void autoLoadFrom(const QString& substitutionPath) {
+    // profiling 为 true 时不合并规则，逐条统计耗时与匹配次数
+    void autoLoadFrom(const QString& substitutionPath, bool profiling = false) {
         if (substitutionPath.isEmpty()) return;
 
         QFileInfo fileInfo(substitutionPath);
         QDir dir = fileInfo.dir();
 
+        // 先在一旁构建新规则集，再原子替换；正在处理文本的线程继续使用旧规则集
+        auto rules = std::make_shared<RegexRuleSet>();
+        QList<RegexRule> preRules;
+        QList<RegexRule> postRules;
         // 加载预处理
-        loadRules(dir.filePath("_Preprocessors.txt"), m_preRules);
+        loadRules(dir.filePath("_Preprocessors.txt"), preRules);
         // 加载后处理
-        loadRules(dir.filePath("_Postprocessors.txt"), m_postRules);
+        loadRules(dir.filePath("_Postprocessors.txt"), postRules);
+        // 编译为执行流水线：相邻规则合并为一次扫描，并按字面量预过滤
+        rules->pre = RegexPipeline(preRules, profiling);
+        rules->post = RegexPipeline(postRules, profiling);
+        rules->digest = digestOf(preRules, postRules);
+        qDebug() << "Regex passes:" << rules->pre.passCount() << "pre," << rules->post.passCount() << "post";
+        std::atomic_store(&m_rules, std::shared_ptr<const RegexRuleSet>(std::move(rules)));
     }
 
     // 执行预处理
     QString processPre(QString text) {
-        for (const auto& rule : m_preRules) {
-            text.replace(rule.pattern, rule.replacement);
-        }
-        return text;
+        // 持有快照直到处理结束，期间重新加载不会影响本次处理
+        std::shared_ptr<const RegexRuleSet> rules = std::atomic_load(&m_rules);
+        return rules->pre.run(std::move(text));
     }
 
     // 执行后处理
     QString processPost(QString text) {
-        for (const auto& rule : m_postRules) {
-            text.replace(rule.pattern, rule.replacement);
-        }
-        return text;
+        std::shared_ptr<const RegexRuleSet> rules = std::atomic_load(&m_rules);
+        return rules->post.run(std::move(text));
+    }
+
+    // 当前规则集的摘要：规则改变后，旧的缓存译文不再命中
+    QByteArray digest() const {
+        return std::atomic_load(&m_rules)->digest;
+    }
+
+    // 单个执行阶段的统计 (按总耗时排序，用于找出代价高的规则)
+    struct Stats {
+        bool post;  // 后处理规则 (否则为预处理)
+        RegexPipeline::PassStats pass;
+    };
+
+    // 耗时最多的 limit 个阶段 (limit <= 0 表示全部)
+    std::vector<Stats> stats(int limit = 0) const {
+        std::shared_ptr<const RegexRuleSet> rules = std::atomic_load(&m_rules);
+        std::vector<Stats> out;
+        for (const auto& pass : rules->pre.stats()) out.push_back({false, pass});
+        for (const auto& pass : rules->post.stats()) out.push_back({true, pass});
+        std::sort(out.begin(), out.end(), [](const Stats& a, const Stats& b) { return a.pass.nanos > b.pass.nanos; });
+        if (limit > 0 && int(out.size()) > limit) out.resize(size_t(limit));
+        return out;
     }
 
 private:
-    RegexManager() {}
+    RegexManager() : m_rules(std::make_shared<RegexRuleSet>()) {}
+
+    // 按顺序对预处理、后处理规则的模式与替换文本求摘要 (顺序不同，结果也可能不同)
+    static QByteArray digestOf(const QList<RegexRule>& preRules, const QList<RegexRule>& postRules) {
+        // 没有任何规则时保持为空，使不使用正则的用户的已有缓存继续有效
+        if (preRules.isEmpty() && postRules.isEmpty()) return QByteArray();
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        const char sep = '\x1f';   // 字段之间的分隔符
+        const char stage = '\x1e'; // 预处理与后处理之间的分隔符
+        for (const QList<RegexRule>* list : {&preRules, &postRules}) {
+            for (const RegexRule& rule : *list) {
+                hash.addData(rule.pattern.pattern().toUtf8());
+                hash.addData(QByteArrayView(&sep, 1));
+                hash.addData(rule.replacement.toUtf8());
+                hash.addData(QByteArrayView(&sep, 1));
+            }
+            hash.addData(QByteArrayView(&stage, 1));
+        }
+        return hash.result().toHex();
+    }
 
     void loadRules(const QString& path, QList<RegexRule>& rules) {
         rules.clear();
@@ -81,6 +142,8 @@ private:
 
                 QRegularExpression regex(patternStr);
                 if (regex.isValid()) {
+                    // 加载时立即编译并 JIT 优化，避免各工作线程在首次匹配时才编译
+                    regex.optimize();
                     rules.append({regex, replaceStr});
                 }
             }
@@ -88,6 +151,6 @@ private:
         qDebug() << "Loaded" << rules.size() << "rules from" << path;
     }
 
-    QList<RegexRule> m_preRules;
-    QList<RegexRule> m_postRules;
+    // 当前发布的规则集 (通过 std::atomic_load/atomic_store 无锁读取与替换)
+    std::shared_ptr<const RegexRuleSet> m_rules;
 };
@@ -0,0 +1,426 @@
+#include "RegexPass.h"
+#include "RegexManager.h"
+#include <QDebug>
+#include <QHash>
+#include <QElapsedTimer>
+#include <algorithm>
+
+namespace {
+// In extended mode whitespace and "# comments" are ignored / 扩展模式下空白与 "# 注释" 被忽略
+bool usesExtendedMode(const QString& pattern) {
+    static const QRegularExpression extended(QStringLiteral(R"(\(\?[a-zA-Z^-]*x)"));
+    return pattern.contains(extended);
+}
+} // namespace
+
+QList<RegexPass> RegexPass::compile(const QList<RegexRule>& rules, bool joinRules) {
+    QList<RegexPass> passes;
+    QList<RegexRule> run; // Consecutive combinable rules / 连续的可合并规则
+    int runStart = 0;
+
+    auto flushRun = [&]() {
+        RegexPass pass;
+        if (run.size() > 1 && combine(run, pass)) {
+            pass.m_firstRule = runStart;
+            passes.append(pass);
+        } else {
+            for (int k = 0; k < run.size(); ++k) {
+                passes.append(single(run[k]));
+                passes.last().m_firstRule = runStart + k;
+            }
+        }
+        run.clear();
+    };
+
+    for (int i = 0; i < rules.size(); ++i) {
+        if (joinRules && isCombinable(rules[i])) {
+            if (run.isEmpty()) runStart = i;
+            run.append(rules[i]);
+        } else {
+            flushRun();
+            passes.append(single(rules[i]));
+            passes.last().m_firstRule = i;
+        }
+    }
+    flushRun();
+    return passes;
+}
+
+bool RegexPass::isCombinable(const RegexRule& rule) {
+    const QString pattern = rule.pattern.pattern();
+    // Start-of-pattern options like (*UTF) must stay first / (*UTF) 等起始选项必须位于表达式开头
+    if (pattern.startsWith("(*")) return false;
+    // In extended mode a trailing "# comment" would swallow the closing parenthesis
+    // 扩展模式下结尾的 "# 注释" 会吞掉外层的右括号
+    if (usesExtendedMode(pattern)) return false;
+
+    // Group numbers and names would shift or clash inside the alternation:
+    // \1..\9, \g, \k, named groups, (?P=name), (?&name), (?R), (?1), (?+1)
+    // 合并后分组编号会偏移、名称会冲突：反向引用、命名分组、递归与子程序调用
+    static const QRegularExpression unsafe(
+        QStringLiteral(R"(\\[1-9gk]|\(\?(P?<[A-Za-z_]|P[=>]|'|&|R\)|[+-]?\d))"));
+    if (pattern.contains(unsafe)) return false;
+
+    // An empty match would win its position over later rules / 空匹配会在该位置抢先于后面的规则
+    if (rule.pattern.match(QString()).hasMatch()) return false;
+    return true;
+}
+
+std::vector<RegexPass::Piece> RegexPass::parseReplacement(const QString& after, int captureCount) {
+    // Same scan as QString::replace(QRegularExpression, QString): "\N" / "\NN" is a reference only
+    // if such a group exists (N > 0); anything else, the backslash included, is literal text
+    // 与 QString::replace 的解析一致：仅当分组存在 (N > 0) 时 "\N" / "\NN" 才是引用，其余 (包括反斜杠) 均按字面输出
+    std::vector<Piece> pieces;
+    QString literal;
+    const qsizetype n = after.size();
+    qsizetype i = 0;
+    while (i < n) {
+        if (after.at(i) == u'\\' && i + 1 < n) {
+            int no = after.at(i + 1).digitValue();
+            if (no > 0 && no <= captureCount) {
+                qsizetype len = 2;
+                if (i + 2 < n) {
+                    int second = after.at(i + 2).digitValue();
+                    if (second != -1 && no * 10 + second <= captureCount) {
+                        no = no * 10 + second;
+                        ++len;
+                    }
+                }
+                if (!literal.isEmpty()) pieces.push_back({literal, 0});
+                literal.clear();
+                pieces.push_back({QString(), no});
+                i += len;
+                continue;
+            }
+        }
+        literal += after.at(i);
+        ++i;
+    }
+    if (!literal.isEmpty()) pieces.push_back({literal, 0});
+    return pieces;
+}
+
+RegexPass RegexPass::single(const RegexRule& rule) {
+    RegexPass pass;
+    pass.m_regex = rule.pattern;
+    // Compile (and JIT) now rather than on the first match of every worker / 立即编译 (并 JIT)，而不是在各工作线程首次匹配时
+    pass.m_regex.optimize();
+    pass.m_rules.push_back({0, parseReplacement(rule.replacement, rule.pattern.captureCount())});
+    return pass;
+}
+
+bool RegexPass::combine(const QList<RegexRule>& rules, RegexPass& pass) {
+    QString pattern;
+    int nextGroup = 1;
+    for (const RegexRule& rule : rules) {
+        if (!pattern.isEmpty()) pattern += u'|';
+        // The wrapping group is the rule's group 0 / 外层分组即该规则的第 0 组
+        pattern += u'(' + rule.pattern.pattern() + u')';
+        pass.m_rules.push_back({nextGroup, parseReplacement(rule.replacement, rule.pattern.captureCount())});
+        nextGroup += 1 + rule.pattern.captureCount();
+    }
+    pass.m_regex = QRegularExpression(pattern);
+
+    if (!pass.m_regex.isValid() || pass.m_regex.captureCount() != nextGroup - 1) {
+        // Should not happen for valid rules; apply them one by one rather than guess
+        // 对合法规则不应发生；宁可逐条执行也不冒险
+        qWarning() << "Regex rules could not be combined, applying them one by one:" << pass.m_regex.errorString();
+        return false;
+    }
+    pass.m_regex.optimize();
+    return true;
+}
+
+int RegexPass::ruleOf(const QRegularExpressionMatch& match) const {
+    if (m_rules.size() == 1) return 0;
+    // Only the matching alternative captures, so the last captured group lies in its range
+    // 只有匹配的分支会捕获，因此最后捕获的分组落在该规则的范围内
+    const int last = match.lastCapturedIndex();
+    auto it = std::upper_bound(m_rules.begin(), m_rules.end(), last,
+                               [](int group, const CompiledRule& r) { return group < r.groupBase; });
+    return int(it - m_rules.begin()) - 1;
+}
+
+int RegexPass::apply(QString& text) const {
+    QRegularExpressionMatchIterator it = m_regex.globalMatch(text);
+    if (!it.hasNext()) return 0;
+
+    QString result;
+    result.reserve(text.size());
+    qsizetype copied = 0;
+    int replaced = 0;
+    while (it.hasNext()) {
+        const QRegularExpressionMatch match = it.next();
+        const int r = ruleOf(match);
+        if (r < 0) continue;
+        const CompiledRule& rule = m_rules[size_t(r)];
+
+        result += QStringView(text).mid(copied, match.capturedStart() - copied);
+        for (const Piece& piece : rule.replacement) {
+            if (piece.group > 0) result += match.capturedView(rule.groupBase + piece.group);
+            else result += piece.literal;
+        }
+        copied = match.capturedEnd();
+        ++replaced;
+    }
+    result += QStringView(text).mid(copied);
+    text = result;
+    return replaced;
+}
+
+namespace {
+// Length of a quantifier at pattern[i] ("*", "+", "?", "{n}", "{n,}", "{n,m}", plus a lazy/possessive
+// suffix) and its minimum count; 0 if there is none
+// pattern[i] 处量词的长度及其最小重复次数；没有量词时返回 0
+qsizetype quantifierAt(const QString& p, qsizetype i, int& minCount) {
+    const qsizetype n = p.size();
+    if (i >= n) return 0;
+    qsizetype len = 0;
+    QChar c = p.at(i);
+    if (c == u'*' || c == u'?') { minCount = 0; len = 1; }
+    else if (c == u'+') { minCount = 1; len = 1; }
+    else if (c == u'{') {
+        qsizetype j = i + 1;
+        int value = 0;
+        bool digits = false;
+        while (j < n && p.at(j).isDigit()) { value = value * 10 + p.at(j).digitValue(); digits = true; ++j; }
+        if (j < n && p.at(j) == u',') {
+            ++j;
+            while (j < n && p.at(j).isDigit()) { digits = true; ++j; }
+        }
+        // "{" without a count is a literal brace. "{,m}" is {0,m} in newer PCRE2 and a literal in
+        // older ones; taking it as optional is right for both
+        // 不带次数的 "{" 是字面量。"{,m}" 在较新的 PCRE2 中等于 {0,m}，在旧版本中是字面量；按可选处理对两者都成立
+        if (!digits || j >= n || p.at(j) != u'}') return 0;
+        minCount = value;
+        len = j - i + 1;
+    }
+    if (len > 0 && i + len < n && (p.at(i + len) == u'?' || p.at(i + len) == u'+')) ++len;
+    return len;
+}
+
+// Position after the parenthesized group starting at pattern[i]
+// 跳过从 pattern[i] 开始的括号分组后的位置
+qsizetype skipGroup(const QString& p, qsizetype i) {
+    const qsizetype n = p.size();
+    int depth = 0;
+    bool inClass = false;
+    for (; i < n; ++i) {
+        QChar c = p.at(i);
+        if (c == u'\\') { ++i; continue; }
+        if (inClass) { if (c == u']') inClass = false; continue; }
+        if (c == u'[') { inClass = true; if (i + 1 < n && p.at(i + 1) == u']') ++i; continue; }
+        if (c == u'(') ++depth;
+        else if (c == u')' && --depth == 0) return i + 1;
+    }
+    return n;
+}
+
+// Position after the character class starting at pattern[i] / 跳过从 pattern[i] 开始的字符类后的位置
+qsizetype skipClass(const QString& p, qsizetype i) {
+    const qsizetype n = p.size();
+    ++i; // '['
+    if (i < n && p.at(i) == u'^') ++i;
+    if (i < n && p.at(i) == u']') ++i; // Leading ']' is literal / 开头的 ']' 是字面量
+    for (; i < n; ++i) {
+        QChar c = p.at(i);
+        if (c == u'\\') { ++i; continue; }
+        if (c == u'[' && i + 1 < n && p.at(i + 1) == u':') { // [:alpha:]
+            qsizetype end = p.indexOf(QStringLiteral(":]"), i + 2);
+            if (end >= 0) { i = end + 1; continue; }
+        }
+        if (c == u']') return i + 1;
+    }
+    return n;
+}
+
+// Position after an escape with a letter or digit (\d, \x41, \x{263A}, \p{L}, \k<name>, \12 ...)
+// 跳过以字母或数字开头的转义序列
+qsizetype skipEscape(const QString& p, qsizetype i) {
+    const qsizetype n = p.size();
+    QChar e = p.at(i + 1);
+    qsizetype j = i + 2;
+    if (j < n && (p.at(j) == u'{' || (p.at(j) == u'<' && (e == u'k' || e == u'g')) ||
+                  (p.at(j) == u'\'' && (e == u'k' || e == u'g')))) {
+        QChar close = p.at(j) == u'{' ? QChar(u'}') : p.at(j) == u'<' ? QChar(u'>') : QChar(u'\'');
+        qsizetype end = p.indexOf(close, j + 1);
+        return end < 0 ? n : end + 1;
+    }
+    if (e == u'x') {
+        auto isHex = [](QChar h) {
+            char16_t u = h.unicode();
+            return (u >= u'0' && u <= u'9') || (u >= u'a' && u <= u'f') || (u >= u'A' && u <= u'F');
+        };
+        for (int k = 0; k < 2 && j < n && isHex(p.at(j)); ++k) ++j;
+    } else if (e == u'c' || e == u'p' || e == u'P') {
+        if (j < n) ++j;
+    } else if (e.isDigit()) {
+        while (j < n && p.at(j).isDigit()) ++j;
+    }
+    return j;
+}
+
+// Longest run of literal characters every match of the branch must contain
+// 分支的每次匹配都必然包含的最长连续字面量
+QString longestRequiredRun(const QString& p) {
+    QString best;
+    QString run;
+    auto commit = [&]() {
+        if (run.size() > best.size()) best = run;
+        run.clear();
+    };
+
+    const qsizetype n = p.size();
+    qsizetype i = 0;
+    while (i < n) {
+        QChar c = p.at(i);
+        QChar literal;
+        bool isLiteral = false;
+        if (c == u'\\') {
+            if (i + 1 >= n) break;
+            QChar e = p.at(i + 1);
+            if (e.isLetterOrNumber()) {
+                i = skipEscape(p, i); // Class, anchor, backreference or code: not a plain literal / 字符类、锚点、引用或编码
+            } else {
+                literal = e;
+                isLiteral = true;
+                i += 2;
+            }
+        } else if (c == u'[') {
+            i = skipClass(p, i);
+        } else if (c == u'(') {
+            i = skipGroup(p, i);
+        } else if (c == u'.' || c == u'^' || c == u'$' || c == u'*' || c == u'+' || c == u'?' || c == u')') {
+            ++i;
+        } else {
+            literal = c;
+            isLiteral = true;
+            ++i;
+        }
+
+        int minCount = 1;
+        qsizetype q = quantifierAt(p, i, minCount);
+        i += q;
+        if (!isLiteral) {
+            commit();
+        } else if (q == 0) {
+            run += literal;
+        } else {
+            // Repeated: present at least minCount times, but the run cannot go on past it
+            // 被重复：至少出现 minCount 次，但连续字面量不能越过它
+            if (minCount > 0) run += literal;
+            commit();
+        }
+    }
+    commit();
+    return best;
+}
+} // namespace
+
+bool RegexPass::requiredLiterals(const QString& pattern, QStringList& literals) {
+    literals.clear();
+    // Quoting and extended mode change what a character means / \Q...\E 与扩展模式会改变字符的含义
+    if (pattern.contains(QStringLiteral("\\Q")) || usesExtendedMode(pattern)) return false;
+
+    // Split on top-level "|" / 按顶层的 "|" 拆分分支
+    QStringList branches;
+    const qsizetype n = pattern.size();
+    qsizetype start = 0;
+    for (qsizetype i = 0; i < n; ++i) {
+        QChar c = pattern.at(i);
+        if (c == u'\\') { ++i; continue; }
+        if (c == u'[') { i = skipClass(pattern, i) - 1; continue; }
+        if (c == u'(') { i = skipGroup(pattern, i) - 1; continue; }
+        if (c == u'|') { branches << pattern.mid(start, i - start); start = i + 1; }
+    }
+    branches << pattern.mid(start);
+
+    for (const QString& branch : branches) {
+        QString literal = longestRequiredRun(branch);
+        if (literal.isEmpty()) { literals.clear(); return false; }
+        literals << literal;
+    }
+    return true;
+}
+
+RegexPipeline::RegexPipeline(const QList<RegexRule>& rules, bool profiling) {
+    m_passes = RegexPass::compile(rules, !profiling);
+
+    // Intern every literal once; a pass is filtered only if all its rules have literals
+    // 每个字面量只登记一次；仅当阶段内所有规则都有字面量时才对该阶段预过滤
+    QHash<QString, int> ids;
+    QStringList patterns;
+    for (RegexPass& pass : m_passes) {
+        m_firstPatterns << rules[pass.m_firstRule].pattern.pattern();
+        std::vector<int> passIds;
+        bool filterable = true;
+        for (int r = pass.m_firstRule; r < pass.m_firstRule + pass.ruleCount() && filterable; ++r) {
+            QStringList literals;
+            if (!RegexPass::requiredLiterals(rules[r].pattern.pattern(), literals)) {
+                filterable = false;
+                break;
+            }
+            for (const QString& literal : literals) {
+                auto it = ids.constFind(literal);
+                if (it == ids.constEnd()) {
+                    it = ids.insert(literal, int(patterns.size()));
+                    patterns << literal;
+                }
+                passIds.push_back(it.value());
+            }
+        }
+        if (filterable) pass.m_literalIds = std::move(passIds);
+    }
+    m_literals.build(patterns);
+    m_literalCount = int(patterns.size());
+}
+
+std::vector<bool> RegexPipeline::scanLiterals(const QString& text) const {
+    std::vector<bool> present(size_t(m_literalCount), false);
+    if (m_literalCount == 0) return present;
+    for (const AhoCorasick::Match& m : m_literals.findAll(text)) present[size_t(m.id)] = true;
+    return present;
+}
+
+QString RegexPipeline::run(QString text) const {
+    if (m_passes.isEmpty()) return text;
+    std::vector<bool> present = scanLiterals(text);
+    QElapsedTimer timer;
+
+    for (const RegexPass& pass : m_passes) {
+        if (!pass.m_literalIds.empty()) {
+            bool possible = false;
+            for (int id : pass.m_literalIds) {
+                if (present[size_t(id)]) { possible = true; break; }
+            }
+            if (!possible) {
+                pass.m_counters->skipped.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+        }
+
+        timer.start();
+        int replaced = pass.apply(text);
+        pass.m_counters->nanos.fetch_add(timer.nsecsElapsed(), std::memory_order_relaxed);
+        pass.m_counters->runs.fetch_add(1, std::memory_order_relaxed);
+        if (replaced == 0) continue;
+        pass.m_counters->matches.fetch_add(quint64(replaced), std::memory_order_relaxed);
+        // A replacement may introduce literals later rules look for / 替换结果可能带来后续规则需要的字面量
+        present = scanLiterals(text);
+    }
+    return text;
+}
+
+std::vector<RegexPipeline::PassStats> RegexPipeline::stats() const {
+    std::vector<PassStats> out;
+    out.reserve(size_t(m_passes.size()));
+    for (int i = 0; i < m_passes.size(); ++i) {
+        const RegexPass& pass = m_passes[i];
+        out.push_back({pass.m_firstRule, pass.ruleCount(), m_firstPatterns.value(i),
+                       pass.m_counters->runs.load(std::memory_order_relaxed),
+                       pass.m_counters->skipped.load(std::memory_order_relaxed),
+                       pass.m_counters->matches.load(std::memory_order_relaxed),
+                       pass.m_counters->nanos.load(std::memory_order_relaxed)});
+    }
+    return out;
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include <QString>
+#include <QList>
+#include <QRegularExpression>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include "AhoCorasick.h"
+
+struct RegexRule;
+
+/**
+ * @brief Several Substitution Rules Compiled into One Scan
+ * @brief 编译为单次扫描的多条替换规则
+ *
+ * Consecutive rules are joined into one alternation "(r1)|(r2)|...". A single pass over
+ * the text finds the leftmost match of any rule (ties go to the earlier rule) and applies
+ * that rule's replacement, instead of one full scan and reallocation per rule.
+ * 将相邻的规则合并为一个分支表达式 "(r1)|(r2)|..."。扫描一次文本即可找到任一规则
+ * 最靠左的匹配 (同一位置以靠前的规则为准) 并套用其替换模板，而不是每条规则各扫描、各分配一次。
+ *
+ * The output equals applying the rules one after another as long as their matches do not
+ * overlap (and no rule matches inside another rule's replacement). Rules that cannot be
+ * joined safely (backreferences, named groups, recursion, rules matching empty text)
+ * get a pass of their own, keeping the rule order.
+ * 只要各规则的匹配互不重叠 (且没有规则匹配到另一规则的替换结果)，输出与逐条应用完全相同。
+ * 无法安全合并的规则 (反向引用、命名分组、递归、可匹配空串的规则) 单独成为一个阶段，规则顺序不变。
+ */
+class RegexPass {
+public:
+    // Group the rules into passes, in order; with joinRules = false every rule is a pass of its own
+    // 按顺序将规则分组为若干阶段；joinRules 为 false 时每条规则单独成为一个阶段
+    static QList<RegexPass> compile(const QList<RegexRule>& rules, bool joinRules = true);
+
+    // Apply this pass and return the number of replacements (0: text untouched, no copy)
+    // 执行本阶段并返回替换次数 (为 0 时文本不变，不复制)
+    int apply(QString& text) const;
+
+    int firstRule() const { return m_firstRule; }
+    int ruleCount() const { return int(m_rules.size()); }
+
+    // Literals at least one of which appears in every match of the pattern; false if none can
+    // be derived (alternations give one literal per branch)
+    // 模式的每次匹配都至少包含其中一个字面量；无法推导时返回 false (分支表达式每个分支给出一个字面量)
+    static bool requiredLiterals(const QString& pattern, QStringList& literals);
+
+private:
+    friend class RegexPipeline;
+
+    // Replacement template, pre-parsed with QString::replace's "\N" rules
+    // 按 QString::replace 的 "\N" 规则预解析的替换模板
+    struct Piece {
+        QString literal;
+        int group = 0; // > 0: insert this capture group of the rule / > 0 时插入规则的该捕获组
+    };
+
+    struct CompiledRule {
+        int groupBase = 0; // Combined group number of the rule's group 0 / 规则第 0 组在合并表达式中的编号
+        std::vector<Piece> replacement;
+    };
+
+    static bool isCombinable(const RegexRule& rule);
+    static std::vector<Piece> parseReplacement(const QString& after, int captureCount);
+    static RegexPass single(const RegexRule& rule);
+    // Join the rules into pass; false if the joined expression is unusable / 合并规则；合并后的表达式不可用时返回 false
+    static bool combine(const QList<RegexRule>& rules, RegexPass& pass);
+
+    // Which rule produced the match / 匹配来自哪条规则
+    int ruleOf(const QRegularExpressionMatch& match) const;
+
+    QRegularExpression m_regex;
+    std::vector<CompiledRule> m_rules;
+    int m_firstRule = 0; // Index of the first rule in the file / 第一条规则在文件中的下标
+
+    // Prefilter: ids in the pipeline's literal scanner; empty = always run
+    // 预过滤：在流水线字面量扫描器中的编号；为空表示总是执行
+    std::vector<int> m_literalIds;
+
+    struct Counters {
+        std::atomic<quint64> runs{0};
+        std::atomic<quint64> skipped{0};
+        std::atomic<quint64> matches{0};
+        std::atomic<qint64> nanos{0};
+    };
+    std::shared_ptr<Counters> m_counters = std::make_shared<Counters>();
+};
+
+/**
+ * @brief Ordered Passes with a Literal Prefilter
+ * @brief 带字面量预过滤的有序执行阶段
+ *
+ * Most rules only match text containing some literal fragment (a color tag, a name, ruby
+ * markup). Those literals are collected from every rule at load time. One Aho-Corasick scan
+ * per line then tells which passes can possibly match, and the others are skipped. The
+ * text is scanned again only after a pass actually changed it.
+ * 大多数规则只会匹配含有某个字面片段 (颜色标签、人名、注音标记) 的文本。加载时从每条规则中
+ * 提取这些字面量，每行文本只需一次 Aho-Corasick 扫描即可得知哪些阶段可能匹配，其余阶段直接跳过。
+ * 只有某个阶段真正修改了文本后才会重新扫描。
+ */
+class RegexPipeline {
+public:
+    struct PassStats {
+        int firstRule;     // 0-based index in the rule file / 在规则文件中的下标 (从 0 开始)
+        int ruleCount;     // Rules joined in this pass / 本阶段合并的规则数
+        QString pattern;   // Pattern of the first rule / 第一条规则的表达式
+        quint64 runs;      // Times the regex was executed / 正则实际执行次数
+        quint64 skipped;   // Times the prefilter skipped it / 被预过滤跳过的次数
+        quint64 matches;   // Replacements made / 替换次数
+        qint64 nanos;      // Total execution time / 总执行耗时
+    };
+
+    RegexPipeline() = default;
+    // profiling = true keeps every rule in its own pass so time is measured per rule
+    // profiling 为 true 时每条规则单独成为一个阶段，从而逐条计时
+    explicit RegexPipeline(const QList<RegexRule>& rules, bool profiling = false);
+
+    QString run(QString text) const;
+
+    int passCount() const { return int(m_passes.size()); }
+    std::vector<PassStats> stats() const;
+
+private:
+    // Which literals occur in text / 文本中出现了哪些字面量
+    std::vector<bool> scanLiterals(const QString& text) const;
+
+    QList<RegexPass> m_passes;
+    QStringList m_firstPatterns; // Per pass, for stats / 每个阶段的首条表达式，用于统计
+    AhoCorasick m_literals;
+    int m_literalCount = 0;
+};
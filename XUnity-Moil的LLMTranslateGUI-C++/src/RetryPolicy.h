@@ -0,0 +1,68 @@
+#pragma once
+#include <QString>
+#include <QRandomGenerator>
+#include <algorithm>
+#include "ApiKeyScheduler.h"
+
+/**
+ * @brief What went wrong (or right) in one translation attempt
+ * @brief 单次翻译尝试的结果
+ */
+struct AttemptStatus {
+    ApiKeyScheduler::Outcome outcome = ApiKeyScheduler::Outcome::Success;
+    int httpStatus = 0;   // 0 if no HTTP response / 无 HTTP 响应时为 0
+    QString apiKey;       // Key used, "" if none was available / 使用的密钥，无可用密钥时为空
+    bool circuitOpen = false; // Refused by the circuit breaker / 被熔断器拒绝
+};
+
+/**
+ * @brief Retry Policy with Jittered Exponential Backoff
+ * @brief 带随机抖动的指数退避重试策略
+ *
+ * Decides whether a failed attempt is worth repeating and how long to wait first.
+ * Requests that can never succeed (bad request, auth failure) are not retried.
+ * 判断失败的尝试是否值得重试以及重试前的等待时间。
+ * 注定无法成功的请求 (请求错误、鉴权失败) 不会重试。
+ */
+class RetryPolicy {
+public:
+    RetryPolicy(int maxAttempts, int baseDelayMs, int maxDelayMs)
+        : m_maxAttempts(std::max(1, maxAttempts)),
+          m_baseDelayMs(std::max(1, baseDelayMs)),
+          m_maxDelayMs(std::max(m_baseDelayMs, maxDelayMs)) {}
+
+    int maxAttempts() const { return m_maxAttempts; }
+
+    // False for errors that would fail again no matter how often we try
+    // 对无论重试多少次都会失败的错误返回 false
+    static bool isRetryable(const AttemptStatus& status) {
+        if (status.circuitOpen) return false;
+        switch (status.outcome) {
+        case ApiKeyScheduler::Outcome::AuthFailed:
+        case ApiKeyScheduler::Outcome::Cancelled:
+            return false;
+        default:
+            break;
+        }
+        // Client errors are permanent, except timeout/conflict/too-early/rate-limit
+        // 客户端错误是永久性的，超时/冲突/过早/限流除外
+        int code = status.httpStatus;
+        if (code >= 400 && code < 500) {
+            return code == 408 || code == 409 || code == 425 || code == 429;
+        }
+        return true;
+    }
+
+    // Delay before retry number `retry` (0-based): half fixed, half random, doubling up to the cap
+    // 第 `retry` 次重试 (从 0 开始) 前的等待：一半固定、一半随机，逐次翻倍直到上限
+    qint64 delayMs(int retry) const {
+        qint64 cap = std::min<qint64>(m_maxDelayMs, qint64(m_baseDelayMs) << std::min(retry, 20));
+        qint64 half = cap / 2;
+        return half + QRandomGenerator::global()->bounded(qint64(cap - half + 1));
+    }
+
+private:
+    int m_maxAttempts;
+    int m_baseDelayMs;
+    int m_maxDelayMs;
+};
@@ -0,0 +1,142 @@
+#pragma once
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <array>
+#include <list>
+#include <mutex>
+#include <atomic>
+
+/**
+ * @brief Sharded In-Memory LRU Cache
+ * @brief 分片内存 LRU 缓存
+ *
+ * Bounded by a byte budget that is split evenly across shards. Each shard has its own
+ * mutex, so thread-pool workers looking up different keys rarely touch the same lock.
+ * 以字节预算为上限，预算平均分配到各分片。每个分片有独立的互斥锁，
+ * 线程池中查询不同键的工作线程几乎不会争用同一把锁。
+ */
+class ShardedLruCache {
+public:
+    static constexpr int SHARD_COUNT = 16;
+
+    struct Stats {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        quint64 evictions = 0;
+        qint64 bytes = 0;
+        int entries = 0;
+    };
+
+    // Set the total byte budget (0 disables the cache) and drop entries over budget
+    // 设置总字节预算 (0 表示禁用) 并淘汰超出预算的条目
+    void setBudget(qint64 bytes) {
+        m_budget = bytes > 0 ? bytes : 0;
+        for (auto& shard : m_shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            evictOverBudget(shard);
+        }
+    }
+
+    bool isEnabled() const { return m_budget > 0; }
+
+    bool lookup(const QByteArray& key, QString& value) {
+        if (!isEnabled()) return false;
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.constFind(key);
+        if (it == shard.index.constEnd()) {
+            m_misses.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        // Move to the front (most recently used) / 移到链表头部 (最近使用)
+        shard.order.splice(shard.order.begin(), shard.order, it.value());
+        value = it.value()->value;
+        m_hits.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void insert(const QByteArray& key, const QString& value) {
+        if (!isEnabled()) return;
+        qint64 bytes = entryBytes(key, value);
+        // Never let one entry flush a whole shard / 单个条目不能挤掉整个分片
+        if (bytes > shardBudget()) return;
+
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            shard.bytes -= it.value()->bytes;
+            shard.order.erase(it.value());
+            shard.index.erase(it);
+        }
+        shard.order.push_front({key, value, bytes});
+        shard.index.insert(key, shard.order.begin());
+        shard.bytes += bytes;
+        evictOverBudget(shard);
+    }
+
+    void clear() {
+        for (auto& shard : m_shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.order.clear();
+            shard.index.clear();
+            shard.bytes = 0;
+        }
+    }
+
+    Stats stats() const {
+        Stats s;
+        s.hits = m_hits.load(std::memory_order_relaxed);
+        s.misses = m_misses.load(std::memory_order_relaxed);
+        s.evictions = m_evictions.load(std::memory_order_relaxed);
+        for (auto& shard : m_shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            s.bytes += shard.bytes;
+            s.entries += shard.index.size();
+        }
+        return s;
+    }
+
+private:
+    struct Node {
+        QByteArray key;
+        QString value;
+        qint64 bytes;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Node> order; // Front = most recently used / 头部 = 最近使用
+        QHash<QByteArray, std::list<Node>::iterator> index;
+        qint64 bytes = 0;
+    };
+
+    // Approximate heap footprint: key + UTF-16 value + list/hash node overhead
+    // 近似内存占用：键 + UTF-16 译文 + 链表/哈希节点开销
+    static qint64 entryBytes(const QByteArray& key, const QString& value) {
+        return key.size() + value.size() * qint64(sizeof(QChar)) + 96;
+    }
+
+    qint64 shardBudget() const { return m_budget / SHARD_COUNT; }
+
+    Shard& shardFor(const QByteArray& key) {
+        return m_shards[qHash(key) % SHARD_COUNT];
+    }
+
+    void evictOverBudget(Shard& shard) {
+        while (shard.bytes > shardBudget() && !shard.order.empty()) {
+            const Node& victim = shard.order.back();
+            shard.bytes -= victim.bytes;
+            shard.index.remove(victim.key);
+            shard.order.pop_back();
+            m_evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<qint64> m_budget{0};
+    std::array<Shard, SHARD_COUNT> m_shards;
+    std::atomic<quint64> m_hits{0};
+    std::atomic<quint64> m_misses{0};
+    std::atomic<quint64> m_evictions{0};
+};
@@ -0,0 +1,211 @@
+#include "SimdSearch.h"
+#include <QChar>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SIMDSEARCH_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SIMDSEARCH_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SIMDSEARCH_TARGET_AVX2
+#endif
+
+namespace {
+
+// Folding table for all UTF-16 code units plus its inverse, built once on first use
+// 所有 UTF-16 码元的大小写折叠表及其反查表，首次使用时构建一次
+struct FoldTable {
+    std::vector<char16_t> fold;                          // unit -> folded unit / 码元 -> 折叠后的码元
+    std::vector<std::pair<char16_t, char16_t>> inverse;  // (folded, unit), sorted / (折叠后, 原码元)，已排序
+
+    FoldTable() : fold(0x10000) {
+        inverse.reserve(0x10000);
+        for (int u = 0; u < 0x10000; ++u) {
+            char16_t f = QChar(char16_t(u)).toCaseFolded().unicode();
+            fold[u] = f;
+            inverse.push_back({f, char16_t(u)});
+        }
+        std::sort(inverse.begin(), inverse.end());
+    }
+
+    static const FoldTable& get() {
+        static const FoldTable table;
+        return table;
+    }
+};
+
+constexpr int kMaxVariants = 3;
+
+// Every unit that folds like c; false if there are too many to compare in SIMD
+// 所有与 c 折叠结果相同的码元；数量过多无法用 SIMD 比较时返回 false
+bool caseVariants(char16_t c, char16_t out[kMaxVariants]) {
+    const FoldTable& t = FoldTable::get();
+    char16_t f = t.fold[c];
+    auto range = std::equal_range(t.inverse.begin(), t.inverse.end(), std::make_pair(f, char16_t(0)),
+                                  [](const auto& a, const auto& b) { return a.first < b.first; });
+    int count = int(range.second - range.first);
+    if (count < 1 || count > kMaxVariants) return false;
+    int n = 0;
+    for (auto it = range.first; it != range.second; ++it) out[n++] = it->second;
+    // Pad with duplicates so the kernels always compare three values / 用重复值补齐，内核固定比较三个值
+    while (n < kMaxVariants) { out[n] = out[n - 1]; ++n; }
+    return true;
+}
+
+bool isSurrogate(char16_t c) { return c >= 0xD800 && c <= 0xDFFF; }
+
+// Compare needle with the haystack at pos, code unit by code unit after folding
+// 在 pos 处将模式串与文本逐码元折叠后比较
+inline bool matchesAt(const char16_t* hay, const char16_t* needle, qsizetype n) {
+    const std::vector<char16_t>& fold = FoldTable::get().fold;
+    for (qsizetype k = 0; k < n; ++k) {
+        if (hay[k] != needle[k] && fold[hay[k]] != fold[needle[k]]) return false;
+    }
+    return true;
+}
+
+struct Anchors {
+    char16_t first[kMaxVariants];
+    char16_t last[kMaxVariants];
+};
+
+inline bool anchorHit(char16_t c, const char16_t v[kMaxVariants]) {
+    return c == v[0] || c == v[1] || c == v[2];
+}
+
+qsizetype scalarScan(const char16_t* hay, qsizetype start, qsizetype end,
+                     const char16_t* needle, qsizetype n, const Anchors& a) {
+    for (qsizetype i = start; i < end; ++i) {
+        if (anchorHit(hay[i], a.first) && anchorHit(hay[i + n - 1], a.last) && matchesAt(hay + i, needle, n)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+#ifdef SIMDSEARCH_X86
+qsizetype sse2Scan(const char16_t* hay, qsizetype start, qsizetype end,
+                   const char16_t* needle, qsizetype n, const Anchors& a) {
+    const __m128i f0 = _mm_set1_epi16(short(a.first[0])), f1 = _mm_set1_epi16(short(a.first[1])),
+                  f2 = _mm_set1_epi16(short(a.first[2]));
+    const __m128i l0 = _mm_set1_epi16(short(a.last[0])), l1 = _mm_set1_epi16(short(a.last[1])),
+                  l2 = _mm_set1_epi16(short(a.last[2]));
+    qsizetype i = start;
+    for (; i + 8 <= end; i += 8) {
+        __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i));
+        __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i + n - 1));
+        __m128i hitFirst = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi16(head, f0), _mm_cmpeq_epi16(head, f1)),
+                                        _mm_cmpeq_epi16(head, f2));
+        __m128i hitLast = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi16(tail, l0), _mm_cmpeq_epi16(tail, l1)),
+                                       _mm_cmpeq_epi16(tail, l2));
+        unsigned mask = unsigned(_mm_movemask_epi8(_mm_and_si128(hitFirst, hitLast)));
+        // Two mask bits per 16-bit lane / 每个 16 位通道对应两个掩码位
+        while (mask) {
+            int lane = 0;
+            while (!(mask & (1u << (lane * 2)))) ++lane;
+            if (matchesAt(hay + i + lane, needle, n)) return i + lane;
+            mask &= ~(3u << (lane * 2));
+        }
+    }
+    return scalarScan(hay, i, end, needle, n, a);
+}
+
+SIMDSEARCH_TARGET_AVX2
+qsizetype avx2Scan(const char16_t* hay, qsizetype start, qsizetype end,
+                   const char16_t* needle, qsizetype n, const Anchors& a) {
+    const __m256i f0 = _mm256_set1_epi16(short(a.first[0])), f1 = _mm256_set1_epi16(short(a.first[1])),
+                  f2 = _mm256_set1_epi16(short(a.first[2]));
+    const __m256i l0 = _mm256_set1_epi16(short(a.last[0])), l1 = _mm256_set1_epi16(short(a.last[1])),
+                  l2 = _mm256_set1_epi16(short(a.last[2]));
+    qsizetype i = start;
+    for (; i + 16 <= end; i += 16) {
+        __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + i));
+        __m256i tail = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + i + n - 1));
+        __m256i hitFirst = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi16(head, f0), _mm256_cmpeq_epi16(head, f1)),
+                                           _mm256_cmpeq_epi16(head, f2));
+        __m256i hitLast = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi16(tail, l0), _mm256_cmpeq_epi16(tail, l1)),
+                                          _mm256_cmpeq_epi16(tail, l2));
+        unsigned mask = unsigned(_mm256_movemask_epi8(_mm256_and_si256(hitFirst, hitLast)));
+        while (mask) {
+            int lane = 0;
+            while (!(mask & (1u << (lane * 2)))) ++lane;
+            if (matchesAt(hay + i + lane, needle, n)) return i + lane;
+            mask &= ~(3u << (lane * 2));
+        }
+    }
+    return sse2Scan(hay, i, end, needle, n, a);
+}
+
+bool cpuHasAvx2() {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) return false; // OS saves YMM state / 系统保存 YMM 状态
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return false;
+#endif
+}
+#endif
+
+using ScanFn = qsizetype (*)(const char16_t*, qsizetype, qsizetype, const char16_t*, qsizetype, const Anchors&);
+
+struct Kernel {
+    ScanFn scan;
+    const char* name;
+};
+
+const Kernel& kernel() {
+    static const Kernel k = []() -> Kernel {
+#ifdef SIMDSEARCH_X86
+        if (cpuHasAvx2()) return {avx2Scan, "avx2"};
+        return {sse2Scan, "sse2"};
+#else
+        return {scalarScan, "scalar"};
+#endif
+    }();
+    return k;
+}
+
+} // namespace
+
+qsizetype SimdSearch::indexOf(QStringView haystack, QStringView needle, qsizetype from) {
+    const qsizetype n = needle.size();
+    const qsizetype h = haystack.size();
+    if (from < 0) from = std::max<qsizetype>(0, from + h);
+    if (n == 0) return from <= h ? from : -1;
+    if (n > h - from) return -1;
+
+    const char16_t* needleData = needle.utf16();
+    // Surrogate pairs fold per code point; leave those to Qt / 代理对按码点折叠，交给 Qt 处理
+    for (qsizetype k = 0; k < n; ++k) {
+        if (isSurrogate(needleData[k])) return haystack.indexOf(needle, from, Qt::CaseInsensitive);
+    }
+    Anchors anchors;
+    if (!caseVariants(needleData[0], anchors.first) || !caseVariants(needleData[n - 1], anchors.last)) {
+        return haystack.indexOf(needle, from, Qt::CaseInsensitive);
+    }
+
+    // Positions i in [from, h - n] are candidates / 候选位置 i 的范围为 [from, h - n]
+    return kernel().scan(haystack.utf16(), from, h - n + 1, needleData, n, anchors);
+}
+
+const char* SimdSearch::kernelName() {
+    return kernel().name;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <QString>
+#include <QStringView>
+
+/**
+ * @brief Vectorized Case-insensitive Substring Search
+ * @brief 向量化的不区分大小写子串查找
+ *
+ * Drop-in replacement for QStringView::indexOf(needle, from, Qt::CaseInsensitive) on hot paths.
+ * The first and last code units of the needle (in every case variant that folds to the same
+ * unit) are compared against 8 (SSE2) or 16 (AVX2) haystack positions at once; only positions
+ * where both match are verified. CJK text, where nothing has case, needs a single compare per anchor.
+ * 在热点路径上替代 QStringView::indexOf(needle, from, Qt::CaseInsensitive)。
+ * 将模式串的首、尾码元 (包括折叠后相同的所有大小写变体) 一次与 8 个 (SSE2) 或 16 个 (AVX2)
+ * 位置比较，只有首尾都匹配的位置才做完整校验。中日韩文字没有大小写，每个锚点只需一次比较。
+ *
+ * The AVX2 path is picked at runtime; non-x86 builds use the scalar fallback.
+ * 运行时自动选择 AVX2 路径；非 x86 平台使用标量回退实现。
+ */
+class SimdSearch {
+public:
+    // Same result as haystack.indexOf(needle, from, Qt::CaseInsensitive) / 结果与 Qt 的不区分大小写 indexOf 相同
+    static qsizetype indexOf(QStringView haystack, QStringView needle, qsizetype from = 0);
+
+    static bool contains(QStringView haystack, QStringView needle) {
+        return indexOf(haystack, needle) >= 0;
+    }
+
+    // Name of the kernel in use ("avx2", "sse2" or "scalar") / 当前使用的内核名称
+    static const char* kernelName();
+};
@@ -0,0 +1,70 @@
+#pragma once
+#include <QtGlobal>
+#include <future>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @brief Single-Flight Request Coalescing
+ * @brief 单飞请求合并
+ *
+ * While a call for a key is in flight, further callers with the same key do not start
+ * their own call; they wait for the first one and receive the same result.
+ * 当某个键的调用正在进行时，相同键的后续调用者不会再发起新调用，
+ * 而是等待第一个调用完成并获得相同的结果。
+ */
+template <typename Value>
+class SingleFlight {
+public:
+    // Run fn for key, or join the call already in flight for it.
+    // `joined` is set to true when the result came from another caller's call.
+    // 为 key 执行 fn，或加入该 key 正在进行的调用。
+    // 若结果来自其他调用者的调用，则将 `joined` 置为 true。
+    template <typename Fn>
+    Value run(const std::string& key, Fn&& fn, bool* joined = nullptr) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto it = m_flights.find(key);
+        if (it != m_flights.end()) {
+            std::shared_future<Value> pending = it->second;
+            lock.unlock();
+            m_saved.fetch_add(1, std::memory_order_relaxed);
+            if (joined) *joined = true;
+            return pending.get();
+        }
+
+        std::promise<Value> prom;
+        m_flights.emplace(key, prom.get_future().share());
+        lock.unlock();
+        if (joined) *joined = false;
+
+        Value result;
+        try {
+            result = fn();
+        } catch (...) {
+            finish(key);
+            prom.set_exception(std::current_exception());
+            throw;
+        }
+        // Unregister before publishing so late arrivals start a fresh call
+        // 先注销再发布结果，之后到达的请求会发起新的调用
+        finish(key);
+        prom.set_value(result);
+        return result;
+    }
+
+    // Number of upstream calls saved by joining an in-flight call
+    // 通过合并进行中的调用而节省的上游调用次数
+    quint64 savedCalls() const { return m_saved.load(std::memory_order_relaxed); }
+
+private:
+    void finish(const std::string& key) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_flights.erase(key);
+    }
+
+    std::mutex m_mutex;
+    std::unordered_map<std::string, std::shared_future<Value>> m_flights;
+    std::atomic<quint64> m_saved{0};
+};
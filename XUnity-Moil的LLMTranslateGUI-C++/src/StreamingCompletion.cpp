@@ -0,0 +1,106 @@
+#include "StreamingCompletion.h"
+#include "json.hpp"
+#include <algorithm>
+
+using json = nlohmann::json;
+
+namespace {
+const QString kTlClose = QStringLiteral("</tl>");
+}
+
+StreamingCompletion::StreamingCompletion(bool stopAtClosingTl) : m_stopAtClosingTl(stopAtClosingTl) {}
+
+/**
+ * @brief Splits the incoming bytes into SSE lines and handles every "data:" event
+ * @brief 将到达的字节切分为 SSE 行，并处理每个 "data:" 事件
+ */
+void StreamingCompletion::feed(const QByteArray& chunk) {
+    m_buffer.append(chunk);
+    qsizetype lineStart = 0;
+    qsizetype newline;
+    while ((newline = m_buffer.indexOf('\n', lineStart)) >= 0) {
+        QByteArray line = m_buffer.mid(lineStart, newline - lineStart).trimmed();
+        lineStart = newline + 1;
+        // Blank lines separate events, ":" lines are keep-alive comments / 空行分隔事件，":" 开头为保活注释
+        if (!line.startsWith("data:")) continue;
+        handleEvent(line.mid(5).trimmed());
+    }
+    m_buffer.remove(0, lineStart);
+}
+
+void StreamingCompletion::handleEvent(const QByteArray& data) {
+    if (data == "[DONE]") {
+        m_finished = true;
+        flushPending();
+        publish(m_content);
+        return;
+    }
+
+    try {
+        json event = json::parse(data.constData(), data.constData() + data.size());
+        if (event.contains("error")) {
+            m_errorEvent = QString::fromUtf8(data);
+            return;
+        }
+        auto usage = event.find("usage");
+        if (usage != event.end() && usage->is_object()) m_usage = TokenManager::parseUsage(*usage);
+        if (!event.contains("choices") || event["choices"].empty()) return; // e.g. trailing usage chunk / 例如末尾的 usage 块
+
+        const json& choice = event["choices"][0];
+        if (choice.contains("delta")) {
+            const json& delta = choice["delta"];
+            // reasoning_content deltas are ignored entirely / reasoning_content 增量直接忽略
+            auto it = delta.find("content");
+            if (it != delta.end() && it->is_string()) {
+                appendContent(QString::fromStdString(it->get<std::string>()));
+            }
+        }
+        auto reason = choice.find("finish_reason");
+        if (reason != choice.end() && !reason->is_null()) {
+            m_finished = true;
+            flushPending();
+            publish(m_content);
+        }
+    } catch (...) {
+        // A malformed event is skipped, the rest of the stream may still be fine
+        // 跳过格式错误的事件，流的其余部分可能仍然正常
+    }
+}
+
+/**
+ * @brief Appends a content delta, dropping anything inside <think>...</think>
+ * @brief 追加内容增量，丢弃 <think>...</think> 内的所有内容
+ * @details Tags may be split across deltas, so a short tail is held back until it is decided.
+ * @details 标签可能被拆分到多个增量中，因此会暂存一小段尾部直到可以判定。
+ */
+void StreamingCompletion::appendContent(const QString& delta) {
+    const qsizetype before = m_content.size();
+    m_thinkFilter.feed(delta, m_content);
+
+    // Only the newly appended region (plus a tag's worth of overlap) needs scanning
+    // 只需扫描新追加的部分 (加上一个标签长度的重叠)
+    if (m_stopAtClosingTl && !m_published && m_content.size() > before) {
+        qsizetype from = std::max<qsizetype>(0, before - kTlClose.size());
+        if (m_content.indexOf(kTlClose, from, Qt::CaseInsensitive) >= 0) publish(m_content);
+    }
+}
+
+void StreamingCompletion::flushPending() {
+    m_thinkFilter.finish(m_content);
+}
+
+void StreamingCompletion::publish(const QString& content) {
+    if (m_published) return;
+    m_published = true;
+    m_early.set_value(content);
+}
+
+QString StreamingCompletion::finish(bool ok) {
+    if (!m_finished) {
+        // Handle a last event without trailing newline / 处理末尾没有换行的最后一个事件
+        if (ok && !m_buffer.isEmpty()) feed("\n");
+        flushPending();
+    }
+    publish(ok ? m_content : QString());
+    return m_content;
+}
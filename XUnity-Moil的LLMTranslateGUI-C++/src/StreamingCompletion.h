@@ -0,0 +1,68 @@
+#pragma once
+#include <QString>
+#include <QByteArray>
+#include <future>
+#include "TagScanner.h"
+#include "TokenManager.h"
+
+/**
+ * @brief Incremental Parser for Streamed Chat Completions (SSE)
+ * @brief 流式对话补全 (SSE) 的增量解析器
+ *
+ * Consumes the raw "data: {...}" events of a stream=true completion as they arrive
+ * and publishes the visible content through a future as early as possible:
+ * right after the closing </tl> (extraction mode), or as soon as the content is finished.
+ * 在 stream=true 的补全到达时逐块解析 "data: {...}" 事件，并尽早通过 future 发布可见内容：
+ * 提取模式下在收到 </tl> 后立即发布，否则在内容结束时发布。
+ *
+ * <think> blocks and reasoning_content deltas are dropped on the fly instead of being buffered.
+ * <think> 块与 reasoning_content 增量在到达时直接丢弃，不做缓冲。
+ *
+ * Not thread-safe: feed() and finish() are called on the network thread only.
+ * 非线程安全：feed() 与 finish() 只在网络线程上调用。
+ */
+class StreamingCompletion {
+public:
+    // stopAtClosingTl: publish at </tl> and keep reading for the <tm> tags that follow
+    // stopAtClosingTl：在 </tl> 处发布结果，并继续读取后续的 <tm> 标签
+    explicit StreamingCompletion(bool stopAtClosingTl);
+
+    // Future that receives the content as soon as it is usable (empty on failure)
+    // 内容可用时即获得结果的 future (失败时为空)
+    std::future<QString> earlyResult() { return m_early.get_future(); }
+
+    // Whether the early result has been set / 早期结果是否已设置
+    bool published() const { return m_published; }
+
+    // Feed raw bytes from the socket / 输入来自套接字的原始字节
+    void feed(const QByteArray& chunk);
+
+    // The stream ended; publishes whatever was received if nothing was published yet
+    // and returns the full visible content
+    // 流已结束；若尚未发布则发布已收到的内容，并返回完整的可见内容
+    QString finish(bool ok);
+
+    // Raw error event sent by the API inside the stream, if any
+    // API 在流中发送的错误事件原文 (如有)
+    QString errorEvent() const { return m_errorEvent; }
+
+    // Usage chunk sent at the end of the stream (stream_options.include_usage), if any
+    // 流末尾发送的 usage 块 (stream_options.include_usage)，如有
+    TokenUsage usage() const { return m_usage; }
+
+private:
+    void handleEvent(const QByteArray& data);
+    void appendContent(const QString& delta);
+    void flushPending();
+    void publish(const QString& content);
+
+    const bool m_stopAtClosingTl;
+    QByteArray m_buffer;    // Incomplete SSE line / 未完整的 SSE 行
+    QString m_content;      // Visible content so far / 目前为止的可见内容
+    TagScanner m_thinkFilter{u"think"}; // Drops <think> blocks across deltas / 跨增量丢弃 <think> 块
+    bool m_finished = false;  // finish_reason or [DONE] seen / 已收到 finish_reason 或 [DONE]
+    bool m_published = false;
+    QString m_errorEvent;
+    TokenUsage m_usage;
+    std::promise<QString> m_early;
+};
@@ -0,0 +1,134 @@
+#pragma once
+#include <QString>
+#include <QStringView>
+#include <algorithm>
+#include "SimdSearch.h"
+
+/**
+ * @brief Linear Scanner for <tag>...</tag> Blocks in Model Replies
+ * @brief 模型回复中 <tag>...</tag> 块的线性扫描器
+ *
+ * Replaces the regular expressions used on replies (<think> removal, <tl> / <tm> extraction,
+ * stripping every tag). Tags are matched case-insensitively with SimdSearch, and each call makes
+ * one pass over the text. Blocks may span lines.
+ * 替代回复处理中使用的正则表达式 (移除 <think>、提取 <tl> / <tm>、清除所有标签)。
+ * 标签匹配不区分大小写 (使用 SimdSearch)，每次调用只扫描文本一遍，块可以跨行。
+ *
+ * The streaming form (feed/finish) removes blocks from text that arrives in pieces: a tag split
+ * across two pieces is held back until it can be decided, and an unclosed block is dropped.
+ * The one-shot strip() is the same scanner fed once, so both response paths agree.
+ * 流式用法 (feed/finish) 从分段到达的文本中移除块：被拆到两段中的标签会暂存到可以判定为止，
+ * 未闭合的块被丢弃。一次性的 strip() 就是只输入一次的同一扫描器，因此两条响应路径的结果一致。
+ */
+class TagScanner {
+public:
+    // tag is the bare name, e.g. u"think" / tag 为不带尖括号的名称，如 u"think"
+    explicit TagScanner(QStringView tag)
+        : m_open(QChar('<') + tag.toString() + QChar('>')),
+          m_close(QStringLiteral("</") + tag.toString() + QChar('>')) {}
+
+    // Append the part of chunk that lies outside blocks to out / 将 chunk 中位于块之外的部分追加到 out
+    void feed(QStringView chunk, QString& out) {
+        // Only a partial tag (a few characters) is ever carried over / 跨段暂存的最多只是半个标签
+        QString joined;
+        QStringView rest = chunk;
+        if (!m_pending.isEmpty()) {
+            joined = m_pending + chunk;
+            rest = joined;
+            m_pending.clear();
+        }
+
+        while (!rest.isEmpty()) {
+            if (m_inside) {
+                qsizetype end = SimdSearch::indexOf(rest, m_close);
+                if (end < 0) {
+                    // Keep only what could be the start of the closing tag / 只保留可能是结束标签开头的部分
+                    m_pending = rest.right(partialTagLength(rest, m_close)).toString();
+                    return;
+                }
+                rest = rest.mid(end + m_close.size());
+                m_inside = false;
+            } else {
+                qsizetype start = SimdSearch::indexOf(rest, m_open);
+                if (start < 0) {
+                    qsizetype keep = partialTagLength(rest, m_open);
+                    out += rest.left(rest.size() - keep);
+                    m_pending = rest.right(keep).toString();
+                    return;
+                }
+                out += rest.left(start);
+                rest = rest.mid(start + m_open.size());
+                m_inside = true;
+            }
+        }
+    }
+
+    // End of input: release a held-back partial tag unless inside a block / 输入结束：若不在块内则输出暂存的半个标签
+    void finish(QString& out) {
+        if (!m_inside) out += m_pending;
+        m_pending.clear();
+        m_inside = false;
+    }
+
+    // Remove every block from a complete text; returns text itself (no copy) if there is none
+    // 从完整文本中移除所有块；没有块时直接返回原文本 (不复制)
+    QString strip(const QString& text) const {
+        if (SimdSearch::indexOf(text, m_open) < 0) return text;
+        TagScanner scanner(*this);
+        scanner.m_inside = false;
+        scanner.m_pending.clear();
+        QString out;
+        out.reserve(text.size());
+        scanner.feed(text, out);
+        scanner.finish(out);
+        return out;
+    }
+
+    // Find the next complete block at or after pos. On success content views its inner text and
+    // pos moves past the closing tag.
+    // 从 pos 开始查找下一个完整的块。成功时 content 指向块内文本，pos 移到结束标签之后。
+    bool nextBlock(QStringView text, qsizetype& pos, QStringView& content) const {
+        qsizetype start = SimdSearch::indexOf(text, m_open, pos);
+        if (start < 0) return false;
+        qsizetype inner = start + m_open.size();
+        qsizetype end = SimdSearch::indexOf(text, m_close, inner);
+        if (end < 0) return false;
+        content = text.mid(inner, end - inner);
+        pos = end + m_close.size();
+        return true;
+    }
+
+    // Remove every "<...>" (same result as removing QRegularExpression("<[^>]*>"))
+    // 移除所有 "<...>" (结果与移除 QRegularExpression("<[^>]*>") 相同)
+    static QString removeAllTags(const QString& text) {
+        qsizetype open = text.indexOf(QChar('<'));
+        if (open < 0) return text;
+        QString out;
+        out.reserve(text.size());
+        qsizetype copied = 0;
+        while (open >= 0) {
+            qsizetype close = text.indexOf(QChar('>'), open + 1);
+            if (close < 0) break; // No closing '>': the rest is plain text / 没有 '>'：其余部分为普通文本
+            out += QStringView(text).mid(copied, open - copied);
+            copied = close + 1;
+            open = text.indexOf(QChar('<'), copied);
+        }
+        out += QStringView(text).mid(copied);
+        return out;
+    }
+
+private:
+    // Length of the longest suffix of text that is a proper prefix of tag (case-insensitive)
+    // text 末尾可作为 tag 真前缀的最长长度 (不区分大小写)
+    static qsizetype partialTagLength(QStringView text, QStringView tag) {
+        for (qsizetype len = std::min(text.size(), tag.size() - 1); len > 0; --len) {
+            if (text.right(len).compare(tag.left(len), Qt::CaseInsensitive) == 0) return len;
+        }
+        return 0;
+    }
+
+    QString m_open;
+    QString m_close;
+    bool m_inside = false;
+    QString m_pending; // Held-back partial tag / 暂存的半个标签
+};
@@ -17,4 +17,43 @@ void TokenManager::reset() {
     m_completionTokens = 0;
     m_totalTokens = 0;
     emit tokensUpdated(0, 0, 0);
-}
\ No newline at end of file
+}
+
+/**
+ * 粗略估算 Token 数：ASCII 约 4 字符 1 个 Token，中日韩等其他字符约 1 字符 1 个 Token
+ * Rough estimate: about 4 ASCII chars per token, about 1 token per CJK or other non-ASCII char
+ */
+long long TokenManager::estimateTokens(const QString& text) {
+    long long ascii = 0;
+    long long other = 0;
+    for (QChar c : text) {
+        if (c.unicode() < 0x80) ++ascii;
+        else if (!c.isLowSurrogate()) ++other;
+    }
+    return (ascii + 3) / 4 + other;
+}
+
+/**
+ * 缓存命中数：OpenAI 为 prompt_tokens_details.cached_tokens，DeepSeek 为 prompt_cache_hit_tokens
+ * Cached tokens: prompt_tokens_details.cached_tokens (OpenAI) or prompt_cache_hit_tokens (DeepSeek)
+ */
+TokenUsage TokenManager::parseUsage(const nlohmann::json& usage) {
+    TokenUsage result;
+    if (!usage.is_object()) return result;
+
+    // 字段缺失或为 null 时视为 0 / Missing or null fields count as 0
+    auto number = [](const nlohmann::json& object, const char* name) -> long long {
+        auto it = object.find(name);
+        return (it != object.end() && it->is_number_integer()) ? it->get<long long>() : 0;
+    };
+
+    result.valid = usage.contains("prompt_tokens");
+    result.prompt = number(usage, "prompt_tokens");
+    result.completion = number(usage, "completion_tokens");
+    auto details = usage.find("prompt_tokens_details");
+    if (details != usage.end() && details->is_object()) {
+        result.cached = number(*details, "cached_tokens");
+    }
+    if (result.cached == 0) result.cached = number(usage, "prompt_cache_hit_tokens");
+    return result;
+}
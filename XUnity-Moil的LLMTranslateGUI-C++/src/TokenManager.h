@@ -1,5 +1,16 @@
 #pragma once
 #include <QObject>
+#include <QString>
+#include "json.hpp"
+
+// 一次调用的 Token 用量 (来自 API 返回的 usage 字段) / Token usage of one call (from the API's usage field)
+struct TokenUsage {
+    long long prompt = 0;
+    long long completion = 0;
+    // 命中服务端前缀缓存的提示词 Token / Prompt tokens served from the provider's prefix cache
+    long long cached = 0;
+    bool valid = false;
+};
 
 // Token 统计管理器 / Manages token usage statistics
 class TokenManager : public QObject {
@@ -17,6 +28,12 @@ public:
     // 重置 / Reset
     void reset();
 
+    // 粗略估算文本的 Token 数 (不调用分词器) / Rough token estimate for a text (no tokenizer call)
+    static long long estimateTokens(const QString& text);
+
+    // 解析 usage 字段 (兼容 OpenAI 与 DeepSeek 的缓存字段) / Parse a usage object (OpenAI and DeepSeek cache fields)
+    static TokenUsage parseUsage(const nlohmann::json& usage);
+
 signals:
     // 通知 UI 更新 / Notify UI to update
     void tokensUpdated(long long total, long long prompt, long long completion);
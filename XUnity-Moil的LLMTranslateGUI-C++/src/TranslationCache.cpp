@@ -0,0 +1,275 @@
+#include "TranslationCache.h"
+#include <QCryptographicHash>
+#include <QSaveFile>
+#include <QDebug>
+#include <algorithm>
+#include <vector>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+TranslationCache::~TranslationCache() {
+    close();
+}
+
+/**
+ * @brief Opens the cache file and rebuilds the key -> offset index
+ * @brief 打开缓存文件并重建 键 -> 偏移 索引
+ */
+bool TranslationCache::open(const QString& path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file.isOpen()) m_file.close();
+    m_index.clear();
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        qDebug() << "Failed to open translation cache" << path << m_file.errorString();
+        return false;
+    }
+
+    // Scan every record once; later records override earlier ones
+    // 顺序扫描所有记录；后出现的记录覆盖先出现的
+    qint64 pos = 0;
+    qint64 records = 0;
+    bool endsWithNewline = true;
+    while (!m_file.atEnd()) {
+        QByteArray line = m_file.readLine();
+        qint64 lineStart = pos;
+        pos += line.size();
+        endsWithNewline = line.endsWith('\n');
+        // A torn last line (crash during write) is ignored / 忽略崩溃时写了一半的最后一行
+        if (!endsWithNewline) break;
+
+        int tab = line.indexOf('\t');
+        if (tab != 40) continue; // SHA-1 hex key is always 40 chars / SHA-1 十六进制键固定 40 字符
+
+        // Strip the line ending; values escape \r and \n, so any raw one belongs to it (e.g. CRLF after editing)
+        // 去掉行尾换行符；译文中的 \r、\n 已被转义，出现的原始字符都属于行尾 (如编辑后变为 CRLF)
+        qsizetype valueEnd = line.size();
+        while (valueEnd > tab + 1 && (line[valueEnd - 1] == '\n' || line[valueEnd - 1] == '\r')) --valueEnd;
+        m_index.insert(line.left(tab), {lineStart + tab + 1, int(valueEnd - tab - 1)});
+        ++records;
+    }
+
+    // Terminate a torn line so the next append starts on a fresh line
+    // 补全被截断的行，保证下一次追加从新行开始
+    if (!endsWithNewline) {
+        m_file.seek(m_file.size());
+        m_file.write("\n");
+        m_file.flush();
+    }
+
+    // Every re-translation (changed prompt, model or glossary) appends another record for the key
+    // 每次重新翻译 (提示词、模型或术语变化) 都会为同一键再追加一条记录
+    const qint64 stale = records - m_index.size();
+    if (stale >= COMPACT_MIN_STALE && records >= qint64(m_index.size()) * COMPACT_RATIO) {
+        if (compact()) qDebug() << "Compacted translation cache," << stale << "stale records dropped";
+        else qDebug() << "Translation cache compaction failed, keeping" << path << "as is";
+    }
+
+    m_syncTimer.start();
+    m_unsynced = false;
+    qDebug() << "Loaded" << m_index.size() << "cached translations from" << path;
+    return true;
+}
+
+void TranslationCache::close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file.isOpen()) {
+        if (m_unsynced) syncToDisk();
+        m_file.close();
+    }
+    m_index.clear();
+    m_hot.clear();
+}
+
+bool TranslationCache::isOpen() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_file.isOpen();
+}
+
+int TranslationCache::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_index.size();
+}
+
+bool TranslationCache::lookup(const QByteArray& key, QString& value) {
+    // Memory tier: sharded locks only, no disk I/O / 内存层：只涉及分片锁，无磁盘 I/O
+    if (m_hot.lookup(key, value)) return true;
+
+    if (!lookupDisk(key, value)) return false;
+    m_diskHits.fetch_add(1, std::memory_order_relaxed);
+    m_hot.insert(key, value); // Promote to memory / 提升到内存层
+    return true;
+}
+
+bool TranslationCache::lookupDisk(const QByteArray& key, QString& value) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.isOpen()) return false;
+
+    auto it = m_index.constFind(key);
+    if (it == m_index.constEnd()) return false;
+
+    // Values are small and the file is hot in the OS page cache, so a seek + read is sub-millisecond
+    // 译文很短且文件常驻系统页缓存，一次 seek + read 远小于 1 毫秒
+    if (!m_file.seek(it->offset)) return false;
+    QByteArray raw = m_file.read(it->length);
+    if (raw.size() != it->length) return false;
+
+    value = unescape(raw);
+    return !value.isEmpty();
+}
+
+void TranslationCache::insert(const QByteArray& key, const QString& value) {
+    if (key.isEmpty() || value.isEmpty()) return;
+    m_hot.insert(key, value);
+
+    QByteArray escaped = escape(value);
+    QByteArray record;
+    record.reserve(key.size() + escaped.size() + 2);
+    record.append(key).append('\t').append(escaped).append('\n');
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.isOpen()) return;
+
+    qint64 recordStart = m_file.size();
+    if (!m_file.seek(recordStart)) return;
+    if (m_file.write(record) != record.size()) return;
+    // flush() hands the record to the OS, which survives a crash or restart of this process
+    // flush() 将记录交给操作系统，本进程崩溃或重启后数据仍在
+    m_file.flush();
+    m_unsynced = true;
+
+    // Pushing to the disk as well (against power loss) costs milliseconds, so it is done at most
+    // once per SYNC_INTERVAL_MS; a power cut loses at most the records of the last interval
+    // 同时刷到磁盘 (防止断电丢失) 需要数毫秒，因此每 SYNC_INTERVAL_MS 最多一次；断电最多丢失最后一个间隔内的记录
+    if (m_syncTimer.hasExpired(SYNC_INTERVAL_MS)) syncToDisk();
+
+    m_index.insert(key, {recordStart + key.size() + 1, int(escaped.size())});
+}
+
+bool TranslationCache::compact() {
+    // Keep the records in file order so the rewritten file reads back the same
+    // 按文件中的顺序保留记录，使重写后的文件读回的结果不变
+    std::vector<std::pair<qint64, QByteArray>> live;
+    live.reserve(size_t(m_index.size()));
+    for (auto it = m_index.constBegin(); it != m_index.constEnd(); ++it) live.push_back({it->offset, it.key()});
+    std::sort(live.begin(), live.end());
+
+    const QString path = m_file.fileName();
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly)) return false;
+    QHash<QByteArray, Entry> index;
+    index.reserve(m_index.size());
+    qint64 pos = 0;
+    for (const auto& record : live) {
+        const Entry entry = m_index.value(record.second);
+        if (!m_file.seek(entry.offset)) return false;
+        const QByteArray value = m_file.read(entry.length);
+        if (value.size() != entry.length) return false;
+        QByteArray line;
+        line.reserve(record.second.size() + value.size() + 2);
+        line.append(record.second).append('\t').append(value).append('\n');
+        if (out.write(line) != line.size()) return false;
+        index.insert(record.second, {pos + record.second.size() + 1, entry.length});
+        pos += line.size();
+    }
+
+    // Windows cannot replace a file that is still open / Windows 无法替换仍处于打开状态的文件
+    m_file.close();
+    const bool replaced = out.commit();
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        m_index.clear();
+        return false;
+    }
+    if (replaced) m_index = std::move(index);
+    return replaced;
+}
+
+bool TranslationCache::syncToDisk() {
+    m_syncTimer.restart();
+    m_unsynced = false;
+#ifdef Q_OS_WIN
+    return _commit(m_file.handle()) == 0;
+#else
+    return ::fsync(m_file.handle()) == 0;
+#endif
+}
+
+/**
+ * @brief Normalizes source text before hashing
+ * @brief 计算哈希前对原文做规范化
+ * @details Trims, unifies line endings and applies Unicode NFC
+ * @details 去除首尾空白，统一换行符，并做 Unicode NFC 规范化
+ */
+QString TranslationCache::normalize(const QString& text) {
+    QString normalized = text.trimmed();
+    normalized.replace("\r\n", "\n");
+    normalized.replace('\r', '\n');
+    return normalized.normalized(QString::NormalizationForm_C);
+}
+
+QByteArray TranslationCache::makeKey(const QString& normalizedText,
+                                     const QString& model,
+                                     const QString& systemPrompt,
+                                     const QString& prePrompt,
+                                     const QString& glossaryContext,
+                                     const QByteArray& regexDigest) {
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    // Unit separator keeps fields from running into each other / 使用单元分隔符防止字段首尾拼接产生歧义
+    const char sep = '\x1f';
+    hash.addData(model.toUtf8());
+    hash.addData(QByteArrayView(&sep, 1));
+    hash.addData(systemPrompt.toUtf8());
+    hash.addData(QByteArrayView(&sep, 1));
+    hash.addData(prePrompt.toUtf8());
+    hash.addData(QByteArrayView(&sep, 1));
+    hash.addData(glossaryContext.toUtf8());
+    hash.addData(QByteArrayView(&sep, 1));
+    // Only present with regex rules, so keys written without any stay unchanged / 仅在有正则规则时加入，无规则时的旧缓存键保持不变
+    if (!regexDigest.isEmpty()) {
+        hash.addData(regexDigest);
+        hash.addData(QByteArrayView(&sep, 1));
+    }
+    hash.addData(normalizedText.toUtf8());
+    return hash.result().toHex();
+}
+
+QByteArray TranslationCache::escape(const QString& value) {
+    QByteArray utf8 = value.toUtf8();
+    QByteArray out;
+    out.reserve(utf8.size());
+    for (char c : utf8) {
+        switch (c) {
+            case '\\': out.append("\\\\"); break;
+            case '\n': out.append("\\n"); break;
+            case '\r': out.append("\\r"); break;
+            case '\t': out.append("\\t"); break;
+            default: out.append(c); break;
+        }
+    }
+    return out;
+}
+
+QString TranslationCache::unescape(const QByteArray& raw) {
+    QByteArray out;
+    out.reserve(raw.size());
+    for (int i = 0; i < raw.size(); ++i) {
+        char c = raw[i];
+        if (c == '\\' && i + 1 < raw.size()) {
+            char n = raw[++i];
+            switch (n) {
+                case 'n': out.append('\n'); break;
+                case 'r': out.append('\r'); break;
+                case 't': out.append('\t'); break;
+                default: out.append(n); break;
+            }
+        } else {
+            out.append(c);
+        }
+    }
+    return QString::fromUtf8(out);
+}
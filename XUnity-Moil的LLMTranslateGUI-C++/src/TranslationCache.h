@@ -0,0 +1,109 @@
+#pragma once
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QFile>
+#include <QElapsedTimer>
+#include <mutex>
+#include <atomic>
+#include "ShardedLruCache.h"
+
+/**
+ * @brief Persistent Translation Cache
+ * @brief 持久化翻译缓存
+ *
+ * Exact-match disk cache placed in front of the LLM. Each record is one line
+ * "<sha1 key>\t<escaped translation>" appended to a UTF-8 text file; only the
+ * key -> file offset index is kept in memory, values are read back on demand.
+ * 精确匹配的磁盘缓存，位于 LLM 调用之前。每条记录为一行
+ * "<sha1 键>\t<转义后的译文>"，以 UTF-8 追加写入文本文件；
+ * 内存中只保留 键 -> 文件偏移 的索引，译文在命中时按需从磁盘读取。
+ *
+ * Hot strings are additionally kept in a sharded in-memory LRU that is checked first.
+ * 热点文本额外保存在分片内存 LRU 中，查询时优先命中内存。
+ */
+class TranslationCache {
+public:
+    TranslationCache() = default;
+    ~TranslationCache();
+
+    // Open (or create) the cache file and rebuild the in-memory index; a file holding mostly
+    // overwritten records is compacted first
+    // 打开 (或创建) 缓存文件并重建内存索引；大部分记录已被覆盖的文件会先压缩
+    bool open(const QString& path);
+
+    // Close the cache file and drop the index
+    // 关闭缓存文件并清空索引
+    void close();
+
+    bool isOpen() const;
+
+    // Set the byte budget of the in-memory tier (0 disables it)
+    // 设置内存层的字节预算 (0 表示禁用)
+    void setMemoryBudget(qint64 bytes) { m_hot.setBudget(bytes); }
+
+    // Look up a translation by key (memory first, then disk); returns false on miss
+    // 按键查找译文 (先内存后磁盘)；未命中返回 false
+    bool lookup(const QByteArray& key, QString& value);
+
+    // Store a translation in memory, append it to disk and index it (last write wins)
+    // 将译文写入内存，并追加写入磁盘、加入索引 (后写覆盖先写)
+    // The file is fsync'ed at most once per SYNC_INTERVAL_MS and on close
+    // 文件最多每 SYNC_INTERVAL_MS 同步到磁盘一次，关闭时也会同步
+    void insert(const QByteArray& key, const QString& value);
+
+    // Number of indexed entries on disk / 磁盘上已索引的条目数
+    int size() const;
+
+    // Counters of the in-memory tier / 内存层统计计数
+    ShardedLruCache::Stats memoryStats() const { return m_hot.stats(); }
+
+    // Hits served from disk (memory misses that were found on disk)
+    // 由磁盘命中的次数 (内存未命中但磁盘命中)
+    quint64 diskHits() const { return m_diskHits.load(std::memory_order_relaxed); }
+
+    // Normalize source text so trivially different requests share one entry
+    // 规范化原文，使仅有细微差别的请求共享同一条缓存
+    static QString normalize(const QString& text);
+
+    // Build the cache key from the normalized text and everything that affects the result
+    // 由规范化原文及所有影响结果的因素 (模型、提示词、术语上下文、正则规则摘要) 生成缓存键
+    static QByteArray makeKey(const QString& normalizedText,
+                              const QString& model,
+                              const QString& systemPrompt,
+                              const QString& prePrompt,
+                              const QString& glossaryContext,
+                              const QByteArray& regexDigest);
+
+    static constexpr int SYNC_INTERVAL_MS = 1000;
+    // Compact on open once the file holds this many times more records than keys, and at least
+    // COMPACT_MIN_STALE overwritten ones
+    // 打开时若记录数达到键数的该倍数，且至少有 COMPACT_MIN_STALE 条被覆盖的记录，则压缩文件
+    static constexpr int COMPACT_RATIO = 2;
+    static constexpr int COMPACT_MIN_STALE = 1000;
+
+private:
+    struct Entry {
+        qint64 offset; // Offset of the escaped value in the file / 转义译文在文件中的偏移
+        int length;    // Length of the escaped value in bytes / 转义译文的字节长度
+    };
+
+    static QByteArray escape(const QString& value);
+    static QString unescape(const QByteArray& raw);
+
+    bool lookupDisk(const QByteArray& key, QString& value);
+    // Rewrite the file with only the indexed records; caller holds m_mutex / 只保留已索引的记录重写文件；调用方需持有 m_mutex
+    bool compact();
+    // fsync / _commit the cache file; caller holds m_mutex / 将缓存文件同步到磁盘；调用方需持有 m_mutex
+    bool syncToDisk();
+
+    ShardedLruCache m_hot;
+    std::atomic<quint64> m_diskHits{0};
+
+    QFile m_file;
+    QHash<QByteArray, Entry> m_index;
+    QElapsedTimer m_syncTimer; // Time since the last fsync / 距上次同步到磁盘的时间
+    bool m_unsynced = false;   // Records flushed but not yet synced / 已 flush 但尚未同步到磁盘的记录
+    // Protects m_file position and m_index / 保护文件读写位置和索引
+    mutable std::mutex m_mutex;
+};
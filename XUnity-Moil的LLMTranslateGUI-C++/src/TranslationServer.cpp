@@ -2,13 +2,19 @@
 #include "json.hpp"
 #include "GlossaryManager.h" 
 #include "RegexManager.h"
-#include <QEventLoop>
+#include "StreamingCompletion.h"
+#include "SimdSearch.h"
+#include "TagScanner.h"
+#include "TokenManager.h"
+#include "JsonWriter.h"
+#include "BatchReply.h"
 #include <QCryptographicHash>
 #include <QRegularExpression> 
 #include <QRandomGenerator>
-#include <regex>              
+#include <QElapsedTimer>
+#include <QDeadlineTimer>
 #include <chrono>
-#include <QTimer> // For setting network request timeout / 用于设置网络请求超时
+#include <algorithm>
 
 using json = nlohmann::json;
 
@@ -22,6 +28,63 @@ const char* SV_ERR_KEY[] = {"错误：API 密钥无效", "Error: Invalid API Key
 const char* SV_ERR_FMT[] = {"错误：响应格式无效", "Error: Invalid Response Format"};
 const char* SV_ERR_JSON[] = {"错误：JSON 解析失败", "Error: JSON Parse Error"};
 const char* SV_NEW_TERM[] = {"✨ 发现新术语: ", "✨ New Term Discovered: "};
+const char* SV_CACHE_HIT[] = {"  ⚡ 缓存命中 -> ", "  ⚡ Cache hit -> "};
+const char* SV_CACHE_LOADED[] = {"翻译缓存已加载，条目数：%1", "Translation cache loaded. Entries: %1"};
+const char* SV_CACHE_FAIL[] = {"⚠️ 无法打开翻译缓存文件：", "⚠️ Failed to open translation cache: "};
+const char* SV_COALESCED[] = {"  🔗 已合并到进行中的相同请求 -> ", "  🔗 Joined identical in-flight request -> "};
+const char* SV_STATS_COALESCED[] = {"📊 请求合并：节省上游调用 %1 次", "📊 Coalescing: %1 upstream calls saved"};
+const char* SV_STATS_CONTEXT[] = {
+    "📊 对话上下文：%1 个 (%2 KB)，空闲移除 %3，超额淘汰 %4",
+    "📊 Contexts: %1 (%2 KB), idle removals %3, evictions over budget %4"
+};
+const char* SV_PROMPT_SIZE[] = {
+    "  📏 提示词约 %1 Token (上下文 %2/%3 轮)",
+    "  📏 Prompt ≈ %1 tokens (context %2/%3 rounds)"
+};
+const char* SV_STATS_PROMPT_CACHE[] = {
+    "📊 提示词缓存：%1 / %2 个提示词 Token 命中服务端缓存 (%3%)",
+    "📊 Prompt cache: %1 of %2 prompt tokens served from the provider cache (%3%)"
+};
+const char* SV_BATCH_SEND[] = {"📦 批量翻译 %1 条文本", "📦 Batch translating %1 lines"};
+const char* SV_BATCH_FALLBACK[] = {
+    "⚠️ 批量结果与原文行数对不上，改为逐条翻译",
+    "⚠️ Batch reply did not line up, falling back per line"
+};
+const char* SV_STATS_LANE[] = {
+    "📊 上游连接 #%1：当前并发流 %2，峰值 %3，已完成 %4 (HTTP/2: %5)",
+    "📊 Upstream connection #%1: streams in flight %2, peak %3, completed %4 (HTTP/2: %5)"
+};
+const char* SV_STATS_CACHE[] = {
+    "📊 内存缓存：命中 %1 / 未命中 %2 / 淘汰 %3，%4 条 (%5 KB)；磁盘命中 %6，磁盘条目 %7",
+    "📊 Memory cache: hits %1 / misses %2 / evictions %3, %4 entries (%5 KB); disk hits %6, disk entries %7"
+};
+const char* SV_KEYS_COOLING[] = {
+    "⏳ 所有 API 密钥都在冷却中，约 %1 秒后可用",
+    "⏳ All API keys are cooling down, next one usable in ~%1 s"
+};
+const char* SV_KEY_COOLDOWN[] = {"⏳ API 密钥 %1 被限流，暂时冷却", "⏳ API key %1 is rate limited, cooling down"};
+const char* SV_KEY_QUARANTINE[] = {
+    "🔒 API 密钥 %1 鉴权失败，已隔离 10 分钟",
+    "🔒 API key %1 was rejected (401/403), quarantined for 10 minutes"
+};
+const char* SV_STATS_KEY[] = {
+    "📊 密钥 %1：进行中 %2，平均延迟 %3 ms，请求 %4，429 %5 次，5xx %6 次，鉴权失败 %7 次%8",
+    "📊 Key %1: in flight %2, avg latency %3 ms, requests %4, 429 x%5, 5xx x%6, auth failures x%7%8"
+};
+const char* SV_STATS_REGEX[] = {
+    "📊 正则 %1 第 %2 条 (合并 %3 条)：执行 %4 次，替换 %5 次，预过滤跳过 %6%，平均 %7 µs，共 %8 ms  %9",
+    "📊 Regex %1 rule %2 (%3 joined): ran %4 times, %5 replacements, prefilter skipped %6%, avg %7 µs, total %8 ms  %9"
+};
+const char* SV_REGEX_PROFILE[] = {"🔬 正则性能分析：最慢的规则", "🔬 Regex profile: slowest rules"};
+const char* SV_REGEX_STAGE[][2] = {{"预处理", "pre"}, {"后处理", "post"}};
+const char* SV_KEY_STATE_COOLING[] = {" [冷却中]", " [cooling down]"};
+const char* SV_KEY_STATE_QUARANTINED[] = {" [已隔离]", " [quarantined]"};
+// Indexed by CircuitBreaker::State / 以 CircuitBreaker::State 为下标
+const char* SV_CIRCUIT[][2] = {
+    {"✅ 上游恢复正常，熔断器已关闭", "✅ Upstream healthy again, circuit closed"},
+    {"⛔ 上游错误率过高，熔断器已打开：暂停调用 API", "⛔ Upstream failing, circuit opened: API calls paused"},
+    {"🩺 熔断器半开：发送探测请求", "🩺 Circuit half-open: sending a probe request"}
+};
 // LLM missing <tl> tag warning / LLM 缺少 <tl> 标签的警告
 const char* SV_WARN_TAG[] = {
     "⚠️ 格式警告：LLM 未返回 <tl> 标签，已自动清洗。",
@@ -30,8 +93,16 @@ const char* SV_WARN_TAG[] = {
 
 // Retry Messages / 重试信息
 const char* SV_RETRY_ATTEMPT[] = {
-    "🔄 重试翻译 (%1/%2): ",
-    "🔄 Retry translation (%1/%2): "
+    "🔄 重试翻译 (%1/%2，等待 %3 ms): ",
+    "🔄 Retry translation (%1/%2, after %3 ms): "
+};
+const char* SV_RETRY_FATAL[] = {
+    "❌ 错误不可重试 (HTTP %1)，放弃本句",
+    "❌ Error is not retryable (HTTP %1), giving up on this line"
+};
+const char* SV_RETRY_DEADLINE[] = {
+    "⏱️ 已到请求截止时间，放弃本句",
+    "⏱️ Request deadline reached, giving up on this line"
 };
 const char* SV_RETRY_SUCCESS[] = {
     "✅ 重试成功",
@@ -42,8 +113,23 @@ const char* SV_RETRY_FAILED[] = {
     "❌ Retry failed, skipping text"
 };
 
+// Reply tags: reasoning block, translation, learned term / 回复标签：思考块、译文、新术语
+static const TagScanner kThinkTag(u"think");
+static const TagScanner kTlTag(u"tl");
+static const TagScanner kTmTag(u"tm");
 
-TranslationServer::TranslationServer(QObject *parent) : QObject(parent), m_running(false) {}
+TranslationServer::TranslationServer(QObject *parent) : QObject(parent), m_running(false) {
+    // Surface breaker state changes in the log and the GUI / 在日志和界面中显示熔断器状态变化
+    m_breaker.setListener([this](CircuitBreaker::State state) {
+        emit logMessage(SV_CIRCUIT[int(state)][m_config.language]);
+        emit circuitStateChanged(int(state));
+    });
+    m_regexProfileTimer.setInterval(REGEX_PROFILE_INTERVAL_MS);
+    connect(&m_regexProfileTimer, &QTimer::timeout, this, [this]() {
+        QStringList lines = regexStatsLines(10);
+        if (!lines.isEmpty()) emit logMessage(QString(SV_REGEX_PROFILE[m_config.language]) + "\n" + lines.join("\n"));
+    });
+}
 // Constructor / 构造函数
 
 TranslationServer::~TranslationServer() {
@@ -55,19 +141,27 @@ TranslationServer::~TranslationServer() {
  * @brief 更新运行时配置
  */
 void TranslationServer::updateConfig(const AppConfig& config) {
-    std::lock_guard<std::mutex> lock(m_keyMutex); // Lock to protect shared config / 锁保护共享配置
     m_config = config;
     
-    // Reset API Key list / 重置 API Key 列表
-    m_apiKeys.clear();
-    QStringList keys = m_config.api_key.split(',', Qt::SkipEmptyParts);
-    for(const auto& k : keys) m_apiKeys.push_back(k.trimmed());
-    m_currentKeyIndex = 0; // Reset index / 重置索引
+    // Reset API Key list; keys that stay keep their rate-limit history / 重置 API Key 列表；保留的密钥沿用其限流记录
+    m_keyScheduler.setKeys(m_config.api_key.split(',', Qt::SkipEmptyParts));
+    
+    // Circuit breaker thresholds / 熔断器阈值
+    CircuitBreaker::Settings breaker;
+    breaker.enabled = m_config.enable_circuit_breaker;
+    breaker.failurePercent = m_config.breaker_failure_percent;
+    breaker.slowCallMs = m_config.breaker_slow_call_ms;
+    breaker.openMs = m_config.breaker_open_seconds * 1000;
+    m_breaker.configure(breaker);
+    m_contexts.configure(m_config.context_memory_bytes, qint64(m_config.context_idle_minutes) * 60 * 1000,
+                         m_config.stable_prompt_prefix);
+    // In-memory cache tier; shrinking evicts at once / 内存缓存层；调小时立即淘汰
+    m_cache.setMemoryBudget(m_config.enable_cache ? m_config.memory_cache_bytes : 0);
     
     // Load glossary and regex / 如果开启了术语表，加载文件
     if (m_config.enable_glossary) {
         GlossaryManager::instance().setFilePath(m_config.glossary_path);
-        RegexManager::instance().autoLoadFrom(m_config.glossary_path); 
+        RegexManager::instance().autoLoadFrom(m_config.glossary_path, m_config.regex_profiling); 
     }
 }
 
@@ -78,6 +172,32 @@ void TranslationServer::updateConfig(const AppConfig& config) {
 void TranslationServer::startServer() {
     if (m_running) return;
     m_running = true;
+    // Open the persistent cache before accepting requests / 在接受请求前打开持久化缓存
+    if (m_config.enable_cache) {
+        m_cache.setMemoryBudget(m_config.memory_cache_bytes);
+        // Empty path means memory-only mode / 路径为空时仅使用内存缓存
+        if (!m_config.cache_path.isEmpty()) {
+            if (m_cache.open(m_config.cache_path)) {
+                emit logMessage(QString(SV_CACHE_LOADED[m_config.language]).arg(m_cache.size()));
+            } else {
+                emit logMessage(QString(SV_CACHE_FAIL[m_config.language]) + m_config.cache_path);
+            }
+        }
+    }
+    // Start the shared upstream client and warm up its connection / 启动共享上游客户端并预热连接
+    // Every worker may have a request in flight; a streamed reply keeps its connection after the
+    // early result while the worker already sends the next one
+    // 每个工作线程都可能有一个进行中的请求；流式回复在提前返回后仍占用连接，而工作线程已在发送下一个请求
+    const int concurrency = std::max(1, m_config.max_threads) * (m_config.enable_streaming ? 2 : 1);
+    m_upstream.start(QUrl(m_config.api_address), m_config.enable_http2, m_config.http2_connections, concurrency);
+    // Start the batch collector before the listener / 在监听前启动批量收集线程
+    if (m_config.enable_batch) {
+        m_batchPool.setMaxThreadCount(std::max(1, m_config.max_threads));
+        m_batchRunning = true;
+        m_batchThread = new std::thread(&TranslationServer::runBatchProcessor, this);
+    }
+    // Periodically log the slowest regex rules while profiling / 性能分析模式下定期输出最慢的正则规则
+    if (m_config.enable_glossary && m_config.regex_profiling) m_regexProfileTimer.start();
     // Start runServerLoop in a new thread / 在新线程中启动 runServerLoop
     m_serverThread = new std::thread(&TranslationServer::runServerLoop, this);
     QString msg = QString(SV_LOG_START[m_config.language]).arg(m_config.port).arg(m_config.max_threads);
@@ -90,9 +210,34 @@ void TranslationServer::startServer() {
  */
 void TranslationServer::stopServer() {
     if (!m_running) return;
-    m_running = false;
-    // Stop httplib server / 停止 httplib 服务器
+    {
+        std::lock_guard<std::mutex> lock(m_stopMutex);
+        m_running = false;
+    }
+    m_stopCv.notify_all(); // Wake workers sleeping between retries / 唤醒在重试间隔中休眠的工作线程
+    m_regexProfileTimer.stop();
+    // Log final counters before tearing anything down / 在释放资源前输出最终统计
+    emit logMessage(statsReport());
+    // Stop accepting requests first, so no new handler reaches the upstream client after it stopped
+    // 首先停止接收请求，使上游客户端停止后不再有新的处理函数调用它
     if (m_svr) m_svr->stop();
+    // Stop the batch collector so no handler keeps waiting on a queued line
+    // 停止批量收集线程，避免处理函数一直等待排队中的文本
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_batchRunning = false;
+    }
+    m_queueCv.notify_all();
+    if (m_batchThread && m_batchThread->joinable()) {
+        m_batchThread->join();
+        delete m_batchThread;
+        m_batchThread = nullptr;
+    }
+    // Abort in-flight upstream calls before waiting for anyone, so batch workers and handlers
+    // return at once instead of after their timeout
+    // 在等待任何线程之前中止进行中的上游调用，使批量工作线程和处理函数立即返回，而不是等到超时
+    m_upstream.stop();
+    m_batchPool.waitForDone();
     // Wait for the thread to finish and clean up / 等待线程结束并回收资源
     if (m_serverThread && m_serverThread->joinable()) {
         m_serverThread->join();
@@ -101,9 +246,78 @@ void TranslationServer::stopServer() {
     }
     delete m_svr;
     m_svr = nullptr;
+    m_cache.close();
     emit logMessage(SV_LOG_STOP[m_config.language]);
 }
 
+/**
+ * @brief Builds a human-readable summary of runtime counters
+ * @brief 生成可读的运行时计数汇总
+ */
+QString TranslationServer::statsReport() const {
+    QStringList lines;
+    if (m_config.enable_cache) {
+        ShardedLruCache::Stats mem = m_cache.memoryStats();
+        lines << QString(SV_STATS_CACHE[m_config.language])
+                     .arg(mem.hits).arg(mem.misses).arg(mem.evictions)
+                     .arg(mem.entries).arg(mem.bytes / 1024)
+                     .arg(m_cache.diskHits()).arg(m_cache.size());
+    }
+    lines << QString(SV_STATS_COALESCED[m_config.language]).arg(m_inflight.savedCalls());
+    const long long promptTokens = m_usagePromptTokens.load(std::memory_order_relaxed);
+    if (promptTokens > 0) {
+        const long long cachedTokens = m_usageCachedTokens.load(std::memory_order_relaxed);
+        lines << QString(SV_STATS_PROMPT_CACHE[m_config.language])
+                     .arg(cachedTokens).arg(promptTokens).arg(cachedTokens * 100 / promptTokens);
+    }
+    ContextStore::Stats contexts = m_contexts.stats();
+    lines << QString(SV_STATS_CONTEXT[m_config.language])
+                 .arg(contexts.contexts).arg(contexts.bytes / 1024)
+                 .arg(contexts.idleEvictions).arg(contexts.budgetEvictions);
+
+    // One line per upstream connection (lane) / 每条上游连接 (通道) 一行
+    const auto lanes = m_upstream.laneStats();
+    for (size_t i = 0; i < lanes.size(); ++i) {
+        lines << QString(SV_STATS_LANE[m_config.language])
+                     .arg(i + 1).arg(lanes[i].inFlight).arg(lanes[i].peakInFlight)
+                     .arg(lanes[i].requests).arg(lanes[i].http2Requests);
+    }
+
+    // One line per API key / 每个 API 密钥一行
+    for (const auto& key : m_keyScheduler.stats()) {
+        QString state = key.quarantined ? QString(SV_KEY_STATE_QUARANTINED[m_config.language])
+                      : key.coolingDown ? QString(SV_KEY_STATE_COOLING[m_config.language]) : QString();
+        lines << QString(SV_STATS_KEY[m_config.language])
+                     .arg(key.label).arg(key.inFlight).arg(key.latencyMs).arg(key.requests)
+                     .arg(key.rateLimited).arg(key.serverErrors).arg(key.authFailures).arg(state);
+    }
+
+    // The most expensive regex passes / 耗时最多的正则阶段
+    if (m_config.enable_glossary) lines << regexStatsLines(5);
+    return lines.join("\n");
+}
+
+/**
+ * @brief One line per regex pass, most expensive first
+ * @brief 每个正则阶段一行，耗时最多的在前
+ */
+QStringList TranslationServer::regexStatsLines(int limit) const {
+    QStringList lines;
+    for (const auto& regex : RegexManager::instance().stats(limit)) {
+        const auto& pass = regex.pass;
+        quint64 total = pass.runs + pass.skipped;
+        if (total == 0) continue;
+        lines << QString(SV_STATS_REGEX[m_config.language])
+                     .arg(SV_REGEX_STAGE[regex.post ? 1 : 0][m_config.language])
+                     .arg(pass.firstRule + 1).arg(pass.ruleCount).arg(pass.runs).arg(pass.matches)
+                     .arg(pass.skipped * 100 / total)
+                     .arg(pass.runs ? pass.nanos / qint64(pass.runs) / 1000 : 0)
+                     .arg(pass.nanos / 1000000)
+                     .arg(pass.pattern.left(40));
+    }
+    return lines;
+}
+
 /**
  * @brief httplib Server Main Loop
  * @brief httplib 服务器主循环
@@ -124,13 +338,57 @@ void TranslationServer::runServerLoop() {
         if (text.isEmpty()) { res.set_content("", "text/plain; charset=utf-8"); return; }
 
         emit logMessage(QString(SV_LOG_REQ[m_config.language]) + text);
+
+        // Regex pre-processing runs once per request; the cache key, the prompt and every retry share it
+        // 正则预处理每个请求只执行一次；缓存键、提示词与每次重试共用其结果
+        const QString processedText = m_config.enable_glossary ? RegexManager::instance().processPre(text) : text;
+
+        // Serve repeated text straight from the persistent cache / 重复文本直接由持久化缓存返回
+        QByteArray cacheKey;
+        if (m_config.enable_cache) {
+            cacheKey = buildCacheKey(text, processedText);
+            QString cached;
+            if (m_cache.lookup(cacheKey, cached)) {
+                emit logMessage(SV_CACHE_HIT[m_config.language] + cached);
+                res.set_content(cached.toStdString(), "text/plain; charset=utf-8");
+                return;
+            }
+        }
+
+        // Upstream is known to be down: fail fast instead of tying up a worker
+        // 已知上游不可用：立即失败，不占用工作线程
+        if (m_breaker.isRejecting()) {
+            res.status = 503;
+            res.set_content("Upstream Unavailable", "text/plain");
+            return;
+        }
         
-        // Execute core translation logic (includes retry) / 执行核心翻译逻辑（包含重试）
-        QString result = performTranslation(text, QString::fromStdString(req.remote_addr));
+        // Execute core translation logic (includes retry); identical concurrent requests
+        // from the same client share one upstream call
+        // 执行核心翻译逻辑（包含重试）；同一客户端的相同并发请求共享一次上游调用
+        QString contextKey = contextKeyFor(req);
+        std::string flightKey = contextKey.toStdString() + '\x1f'
+                              + TranslationCache::normalize(text).toStdString();
+        bool joined = false;
+        QString result = m_inflight.run(flightKey, [&]() {
+            return m_config.enable_batch ? enqueueBatch(text, processedText)
+                                         : performTranslation(text, processedText, contextKey, requestDeadline());
+        }, &joined);
+
+        if (joined) {
+            emit logMessage(SV_COALESCED[m_config.language] + result);
+        } else if (!result.isEmpty() && !cacheKey.isEmpty()) {
+            // Remember successful translations (once, by the caller that did the work)
+            // 记录成功的翻译结果 (仅由实际执行调用的请求写入一次)
+            m_cache.insert(cacheKey, result);
+        }
         
         // Core Fix: Set HTTP status code based on result validity
         // 核心修复：根据结果是否为空来设置 HTTP 状态码
-        if (result.isEmpty()) {
+        if (result.isEmpty() && m_breaker.state() != CircuitBreaker::State::Closed) {
+            res.status = 503; // Circuit open: the API is down / 熔断已打开：API 不可用
+            res.set_content("Upstream Unavailable", "text/plain");
+        } else if (result.isEmpty()) {
             res.status = 500; // Return 500 status code for failure / 返回 500 错误码，通知 XUnity 翻译失败
             res.set_content("Translation Failed", "text/plain"); 
         } else {
@@ -143,53 +401,266 @@ void TranslationServer::runServerLoop() {
     m_svr->listen("0.0.0.0", m_config.port);
 }
 
+/**
+ * @brief Queues one line for the batch collector and waits for its translation
+ * @brief 将一条文本交给批量收集线程并等待其译文
+ * @details Batch mode is stateless on every path (batched, single or fallback), so a line's prompt
+ *          does not depend on which lines happened to share its window.
+ * @details 批量模式在所有路径 (整批、单条或回退) 上都是无状态的，一行文本的提示词不取决于
+ *          恰好与它同处一个窗口的其他文本。
+ */
+QString TranslationServer::enqueueBatch(const QString& text, const QString& processedText) {
+    // The deadline starts now, so the batch window counts against it / 截止时间从此刻开始计算，批量窗口也计入其中
+    const QDeadlineTimer deadline = requestDeadline();
+    // Multi-line text cannot be expressed in the numbered line format / 多行文本无法用编号单行格式表达
+    if (text.contains('\n')) return performTranslation(text, processedText, QString(), deadline);
+
+    auto pending = std::make_shared<PendingRequest>();
+    pending->originalText = text;
+    pending->processedText = processedText;
+    pending->deadline = deadline;
+    pending->prom = std::make_shared<std::promise<QString>>();
+    std::future<QString> future = pending->prom->get_future();
+
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        if (m_batchRunning) {
+            m_requestQueue.push_back(pending);
+            queued = true;
+        }
+    }
+    // Collector is shutting down, translate directly / 收集线程正在关闭，直接翻译
+    if (!queued) return performTranslation(text, processedText, QString(), deadline);
+
+    m_queueCv.notify_one();
+    if (deadline.isForever()) return future.get();
+    // The batch call and its fallback both stop at the deadline; never hold the worker past it
+    // 批量调用及其回退都会在截止时间停止；工作线程也绝不等待超过截止时间
+    if (future.wait_for(std::chrono::milliseconds(deadline.remainingTime())) != std::future_status::ready) {
+        emit logMessage(SV_RETRY_DEADLINE[m_config.language]);
+        return "";
+    }
+    return future.get();
+}
+
+/**
+ * @brief Batch collector loop
+ * @brief 批量收集循环
+ * @details The window opens when the first line arrives; the batch is sent when the window
+ *          closes or batch_max_lines lines are waiting, whichever comes first.
+ * @details 第一条文本到达时开启时间窗口；窗口结束或排队达到 batch_max_lines 条时 (以先到者为准) 发送整批。
+ */
+void TranslationServer::runBatchProcessor() {
+    const auto window = std::chrono::milliseconds(std::max(1, m_config.batch_window_ms));
+    const size_t maxLines = size_t(std::max(1, m_config.batch_max_lines));
+
+    while (true) {
+        std::vector<std::shared_ptr<PendingRequest>> batch;
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            m_queueCv.wait(lock, [this] { return !m_batchRunning || !m_requestQueue.empty(); });
+            if (!m_batchRunning) break;
+
+            auto deadline = std::chrono::steady_clock::now() + window;
+            m_queueCv.wait_until(lock, deadline, [&] {
+                return !m_batchRunning || m_requestQueue.size() >= maxLines;
+            });
+
+            while (!m_requestQueue.empty() && batch.size() < maxLines) {
+                batch.push_back(m_requestQueue.front());
+                m_requestQueue.pop_front();
+            }
+        }
+        // Send upstream on a worker so the next window can open immediately
+        // 交给工作线程发送，使下一个时间窗口可以立即开始
+        m_batchPool.start([this, batch]() mutable { processBatch(batch); });
+    }
+
+    // Fail whatever is still queued so no handler waits forever / 让仍在排队的文本失败返回，避免处理函数永远等待
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    for (auto& pending : m_requestQueue) pending->prom->set_value("");
+    m_requestQueue.clear();
+}
+
+/**
+ * @brief Translates a whole batch with one numbered multi-line prompt
+ * @brief 用一个编号多行提示词翻译整批文本
+ * @details Batches are stateless: they neither read nor extend the per-client context.
+ *          Any mismatch in the reply falls back to translating each line on its own.
+ * @details 批量请求不使用也不追加客户端上下文。回复对不上时，每条文本各自单独翻译。
+ */
+void TranslationServer::processBatch(std::vector<std::shared_ptr<PendingRequest>>& batch) {
+    if (batch.empty()) return;
+
+    // A single line gains nothing from batching / 单条文本无需批量
+    if (batch.size() == 1) {
+        batch[0]->prom->set_value(performTranslation(batch[0]->originalText, batch[0]->processedText, QString(), batch[0]->deadline));
+        return;
+    }
+
+    emit logMessage(QString(SV_BATCH_SEND[m_config.language]).arg(batch.size()));
+
+    // 1. Lines after regex pre-processing (done by the handler) / 经过正则预处理的各行 (由处理函数完成)
+    QStringList lines;
+    for (const auto& pending : batch) lines << pending->processedText;
+
+    // 2. Glossary terms for the whole batch and the batch instruction / 整批文本的术语与批量指令
+    QString requestPrompt;
+    if (m_config.enable_glossary) {
+        QString glossaryContext = GlossaryManager::instance().getContextPrompt(lines.join("\n"), m_config.glossary_token_budget);
+        if (!glossaryContext.isEmpty()) {
+            requestPrompt += "\n\n" + glossaryContext;
+        }
+    }
+    requestPrompt += QString("\n\n【Instruction】:\n"
+                            "1. The user message contains %1 numbered lines in the form \"<n>. <text>\".\n"
+                            "2. Translate each line independently and reply with exactly %1 lines "
+                            "in the same \"<n>. <translation>\" format.\n"
+                            "3. Do not merge, split, skip or add lines, and output nothing else.")
+                        .arg(batch.size());
+
+    QString userContent = m_config.pre_prompt + "\n";
+    for (int i = 0; i < lines.size(); ++i) {
+        userContent += QString::number(i + 1) + ". " + lines[i] + "\n";
+    }
+
+    QString systemPrompt = m_config.system_prompt;
+    if (m_config.stable_prompt_prefix) {
+        userContent = requestPrompt.trimmed() + "\n\n" + userContent;
+    } else {
+        systemPrompt += requestPrompt;
+    }
+
+    std::vector<ChatMessage> messages;
+    messages.push_back({"system", systemPrompt});
+    messages.push_back({"user", userContent});
+
+    // 3. One upstream call for the whole batch, bounded by the earliest deadline in it
+    // 整批只发起一次上游调用，时长不超过批内最早的截止时间
+    qint64 timeoutMs = UPSTREAM_TIMEOUT_MS;
+    for (const auto& pending : batch) {
+        if (!pending->deadline.isForever()) timeoutMs = std::min(timeoutMs, pending->deadline.remainingTime());
+    }
+    QStringList results;
+    bool ok = false;
+    QString apiKey = timeoutMs > 0 ? acquireApiKey() : QString();
+    if (!apiKey.isEmpty()) {
+        QString rawContent = requestCompletion(messages, apiKey, nullptr, nullptr, int(timeoutMs));
+        rawContent = kThinkTag.strip(rawContent);
+        ok = BatchReply::split(rawContent, int(batch.size()), results);
+        for (int i = 0; ok && i < results.size(); ++i) {
+            if (m_config.enable_glossary) results[i] = RegexManager::instance().processPost(results[i]);
+            ok = isValidTranslationResult(results[i]);
+        }
+    }
+
+    // 4. Hand each line its own translation / 把译文逐条交还给各自的请求
+    if (ok) {
+        for (size_t i = 0; i < batch.size(); ++i) {
+            emit logMessage("  -> " + results[int(i)]);
+            batch[i]->prom->set_value(results[int(i)]);
+        }
+        return;
+    }
+
+    // 5. Fallback: translate each line on its own, in parallel / 回退：并行逐条翻译
+    emit logMessage(SV_BATCH_FALLBACK[m_config.language]);
+    for (const auto& pending : batch) {
+        m_batchPool.start([this, pending]() {
+            pending->prom->set_value(performTranslation(pending->originalText, pending->processedText, QString(), pending->deadline));
+        });
+    }
+}
+
+QDeadlineTimer TranslationServer::requestDeadline() const {
+    // request_deadline_ms <= 0: no overall deadline / request_deadline_ms <= 0：不设总截止时间
+    return m_config.request_deadline_ms > 0 ? QDeadlineTimer(m_config.request_deadline_ms)
+                                            : QDeadlineTimer(QDeadlineTimer::Forever);
+}
+
 /**
  * @brief Core translation function, includes retry logic
  * @brief 核心翻译函数，包含重试逻辑
- * @details Attempts translation up to MAX_RETRY_COUNT times
- * @details 尝试 MAX_RETRY_COUNT 次，直到成功或达到最大次数
+ * @details Retries with jittered exponential backoff, moves to a different key on every retry,
+ *          never retries permanent errors and gives up once the request deadline is reached.
+ * @details 使用带随机抖动的指数退避重试，每次重试换用不同的密钥；
+ *          永久性错误不重试，到达请求截止时间后放弃。
  */
-QString TranslationServer::performTranslation(const QString& text, const QString& clientIP) {
-    QString resultText = "";
-    int retryCount = 0;
-    const int MAX_RETRY_COUNT = 5;
-    const int RETRY_DELAY_MS = 1000;
-    
+QString TranslationServer::performTranslation(const QString& text, const QString& processedText, const QString& contextKey,
+                                              QDeadlineTimer deadline) {
+    RetryPolicy policy(m_config.retry_max_attempts, m_config.retry_base_delay_ms, m_config.retry_max_delay_ms);
+    QSet<QString> usedKeys;
+
     // Retry loop / 重试循环
-    while (retryCount < MAX_RETRY_COUNT) {
-        if (retryCount > 0) {
-            // Log retry information / 记录重试信息
-            QString retryMsg = QString(SV_RETRY_ATTEMPT[m_config.language])
-                                  .arg(retryCount + 1)
-                                  .arg(MAX_RETRY_COUNT) + text;
-            emit logMessage(retryMsg);
-            
-            // Retry delay (blocks current thread) / 重试延迟（阻塞当前线程）
-            QThread::msleep(RETRY_DELAY_MS);
+    for (int attempt = 0; attempt < policy.maxAttempts() && m_running; ++attempt) {
+        // Already spent waiting for a batch that failed / 已在失败的批量请求上耗尽时间
+        if (deadline.hasExpired()) {
+            emit logMessage(SV_RETRY_DEADLINE[m_config.language]);
+            break;
         }
-        
+        // Each attempt gets at most the time left before the deadline / 每次尝试最多使用截止前剩余的时间
+        qint64 remaining = deadline.isForever() ? UPSTREAM_TIMEOUT_MS : deadline.remainingTime();
+        int timeoutMs = int(std::min<qint64>(UPSTREAM_TIMEOUT_MS, remaining));
+
         // Perform a single translation attempt / 执行单次翻译尝试
-        QString attemptResult = performSingleTranslationAttempt(text, clientIP);
-        
+        AttemptStatus status;
+        QString attemptResult = performSingleTranslationAttempt(processedText, contextKey, timeoutMs, usedKeys, &status);
+
         // Check if the result is valid / 检查结果是否有效
         if (isValidTranslationResult(attemptResult)) {
-            if (retryCount > 0) {
+            if (attempt > 0) {
                 emit logMessage(SV_RETRY_SUCCESS[m_config.language]);
             }
-            resultText = attemptResult;
-            break; // Success, exit retry loop / 成功，退出重试循环
+            return attemptResult; // Success, exit retry loop / 成功，退出重试循环
         }
-        
-        retryCount++;
-        
-        // If all retries failed / 如果所有重试都失败
-        if (retryCount >= MAX_RETRY_COUNT) {
-            emit logMessage(SV_RETRY_FAILED[m_config.language]);
-            resultText = ""; // Ensure empty string is returned / 确保返回空字符串
+        if (!status.apiKey.isEmpty()) usedKeys.insert(status.apiKey);
+
+        // Permanent errors fail the same way every time / 永久性错误每次都会同样失败
+        if (!RetryPolicy::isRetryable(status)) {
+            if (!status.circuitOpen) {
+                emit logMessage(QString(SV_RETRY_FATAL[m_config.language]).arg(status.httpStatus));
+            }
+            break;
+        }
+        if (attempt + 1 >= policy.maxAttempts()) break;
+
+        // Back off, but never less than it takes for a key to come out of cool-down
+        // 退避等待，且不短于某个密钥结束冷却所需的时间
+        qint64 keyWait = m_keyScheduler.waitForKeyMs();
+        if (keyWait < 0) {
+            break; // No usable key at all (missing or quarantined) / 完全没有可用密钥 (未配置或已隔离)
+        }
+        qint64 delay = std::max(policy.delayMs(attempt), keyWait);
+        // An attempt left with a sliver of time is bound to time out / 只剩零星时间的尝试注定超时
+        if (!deadline.isForever() && deadline.remainingTime() - delay < MIN_ATTEMPT_BUDGET_MS) {
+            emit logMessage(SV_RETRY_DEADLINE[m_config.language]);
+            break;
         }
+
+        // Log retry information / 记录重试信息
+        QString retryMsg = QString(SV_RETRY_ATTEMPT[m_config.language])
+                              .arg(attempt + 2)
+                              .arg(policy.maxAttempts())
+                              .arg(delay) + text;
+        emit logMessage(retryMsg);
+
+        // Retry delay, cut short when the server stops / 重试等待，服务停止时提前结束
+        if (!waitUnlessStopped(delay)) break;
     }
-    
-    return resultText;
+
+    // All retries failed / 所有重试都失败
+    emit logMessage(SV_RETRY_FAILED[m_config.language]);
+    return ""; // Ensure empty string is returned / 确保返回空字符串
+}
+
+/**
+ * @brief Sleeps for ms milliseconds; returns false early if the server is stopping
+ * @brief 休眠 ms 毫秒；服务停止时提前返回 false
+ */
+bool TranslationServer::waitUnlessStopped(qint64 ms) {
+    std::unique_lock<std::mutex> lock(m_stopMutex);
+    return !m_stopCv.wait_for(lock, std::chrono::milliseconds(ms), [this] { return !m_running; });
 }
 
 /**
@@ -204,8 +675,8 @@ bool TranslationServer::isValidTranslationResult(const QString& result) {
     // Also checks for common Chinese/English failure phrases / 检查中文/英文的失败提示
     return !result.isEmpty() && 
            !result.startsWith("Error", Qt::CaseInsensitive) &&
-           !result.contains("翻译失败", Qt::CaseInsensitive) &&
-           !result.contains("translation failed", Qt::CaseInsensitive) &&
+           !SimdSearch::contains(result, u"翻译失败") &&
+           !SimdSearch::contains(result, u"translation failed") &&
            result.length() > 0;
 }
 
@@ -215,40 +686,35 @@ bool TranslationServer::isValidTranslationResult(const QString& result) {
  * @details Contains the core network request and parsing logic
  * @details 核心网络请求和解析逻辑
  */
-QString TranslationServer::performSingleTranslationAttempt(const QString& text, const QString& clientIP) {
-    // 1. Get API Key / 获取 API Key
-    QString apiKey = getNextApiKey();
+QString TranslationServer::performSingleTranslationAttempt(const QString& processedText, const QString& contextKey, int timeoutMs,
+                                                           const QSet<QString>& avoidKeys, AttemptStatus* status) {
+    // 1. Get API Key, preferring one this request has not failed on yet / 获取 API Key，优先选择本请求尚未失败过的
+    QString apiKey = acquireApiKey(avoidKeys);
+    if (status) status->apiKey = apiKey;
     if (apiKey.isEmpty()) {
-        QString err = SV_ERR_KEY[m_config.language];
-        emit logMessage("❌ " + err + " (No API Key Available)");
         return ""; // API Key error, return empty / API Key 错误，返回空
     }
 
-    // 2. Regex Pre-processing / 正则预处理
-    QString processedText = text;
-    if (m_config.enable_glossary) {
-        processedText = RegexManager::instance().processPre(text);
-    }
-
-    // Generate client ID for context management / 生成客户端 ID 用于上下文管理
-    std::string clientId = generateClientId(clientIP.toStdString()).toStdString();
+    const QByteArray contextId = contextKey.toUtf8();
+    const bool stateless = contextKey.isEmpty(); // Batch mode / 批量模式
     
     QString finalSystemPrompt = m_config.system_prompt;
+    QString requestPrompt; // Per-request glossary terms and instructions / 每次请求各不相同的术语与指令
     bool performExtraction = false; // Flag to enable term extraction / 启用术语提取的标志
 
-    // 3. RAG & Self-evolution Logic / RAG & 自进化逻辑 (Build glossary context and instructions)
+    // 2. RAG & Self-evolution Logic / RAG & 自进化逻辑 (Build glossary context and instructions)
     // 构建术语上下文和指令
     if (m_config.enable_glossary) {
-        QString glossaryContext = GlossaryManager::instance().getContextPrompt(processedText);
+        QString glossaryContext = GlossaryManager::instance().getContextPrompt(processedText, m_config.glossary_token_budget);
         if (!glossaryContext.isEmpty()) {
-            finalSystemPrompt += "\n\n" + glossaryContext;
+            requestPrompt += "\n\n" + glossaryContext;
         }
 
         // Randomly enable term extraction mode (approx 33% chance)
         // 随机启用术语提取模式 (约 33% 几率)
-        if (processedText.length() > 8 && QRandomGenerator::global()->bounded(100) < 33) {
+        if (!stateless && processedText.length() > 8 && QRandomGenerator::global()->bounded(100) < 33) {
             performExtraction = true;
-            finalSystemPrompt += "\n\n【Instruction】:\n"
+            requestPrompt += "\n\n【Instruction】:\n"
                                  "1. Put translation in <tl>...</tl> tags.\n"
                                  "2. If you find NEW proper nouns (names, places) NOT in Known Terms, "
                                  "extract them in <tm>Original=Translated</tm> tags (one per line).\n"
@@ -256,189 +722,428 @@ QString TranslationServer::performSingleTranslationAttempt(const QString& text,
         }
     }
 
-    // 4. Build Message History (Context Memory) / 构建消息历史 (上下文记忆)
-    json messages = json::array();
-    messages.push_back({{"role", "system"}, {"content", finalSystemPrompt.toStdString()}});
+    // With stable_prompt_prefix the system prompt never changes, so the provider can reuse its
+    // prefix cache for the system prompt and the history; the per-request part goes last
+    // 开启 stable_prompt_prefix 时系统提示词保持不变，服务端可复用系统提示词与历史的前缀缓存；
+    // 每次请求各不相同的部分放在最后
+    QString currentUserContent = m_config.pre_prompt + processedText;
+    QString finalUserContent = currentUserContent;
+    if (m_config.stable_prompt_prefix) {
+        if (!requestPrompt.isEmpty()) finalUserContent = requestPrompt.trimmed() + "\n\n" + currentUserContent;
+    } else {
+        finalSystemPrompt += requestPrompt;
+    }
+
+    // 3. Build Message History (Context Memory) / 构建消息历史 (上下文记忆)
+    std::vector<ChatMessage> messages;
+    messages.push_back({"system", finalSystemPrompt});
 
-    // Context lock protection / 上下文锁保护
-    std::lock_guard<std::mutex> lock(m_contextMutex);
-    // Initialize context if not exists / 如果上下文不存在则初始化
-    if (m_contexts.find(clientId) == m_contexts.end()) {
-        m_contexts[clientId] = {std::deque<std::pair<QString, QString>>(), m_config.context_num};
+    // Only the copy is taken under the lock; the API call below runs unlocked
+    // 只有复制过程持锁；下面的 API 调用不持锁
+    const ContextStore::Snapshot context = stateless ? ContextStore::Snapshot()
+                                                     : m_contexts.snapshot(contextId, m_config.context_num);
+
+    long long promptTokens = TokenManager::estimateTokens(finalSystemPrompt)
+                           + TokenManager::estimateTokens(finalUserContent) + 2 * MESSAGE_TOKEN_OVERHEAD;
+
+    // Keep the newest rounds that fit the context token budget / 在上下文 Token 预算内保留最新的若干轮
+    const size_t rounds = context.history.size();
+    const long long budget = m_config.context_token_budget;
+    std::vector<long long> costs(rounds);
+    long long contextTokens = 0;
+    for (size_t i = 0; i < rounds; ++i) {
+        const auto& pair = context.history[i];
+        costs[i] = TokenManager::estimateTokens(pair.first) + TokenManager::estimateTokens(pair.second)
+                 + 2 * MESSAGE_TOKEN_OVERHEAD;
+        contextTokens += costs[i];
     }
-    Context& ctx = m_contexts[clientId];
-    
-    // Check and update max context length / 检查并更新上下文最大长度
-    if (ctx.max_len != m_config.context_num) {
-        ctx.max_len = m_config.context_num;
-        while (ctx.history.size() > ctx.max_len) ctx.history.pop_front();
+    size_t firstRound = 0;
+    if (budget > 0 && m_config.stable_prompt_prefix) {
+        // The history is cut into blocks of about half the budget, counted from its oldest round, and
+        // only whole blocks are dropped: the first round sent stays the same until a block goes
+        // 历史从最旧的一轮开始按约一半预算划分成块，只整块丢弃：发送的第一轮在下一次丢弃整块之前保持不变
+        while (firstRound < rounds && contextTokens > budget) {
+            long long blockTokens = 0;
+            do {
+                blockTokens += costs[firstRound];
+                contextTokens -= costs[firstRound++];
+            } while (firstRound < rounds && blockTokens + costs[firstRound] <= budget / 2);
+        }
+    } else if (budget > 0) {
+        while (firstRound < rounds && contextTokens > budget) contextTokens -= costs[firstRound++];
     }
+    promptTokens += contextTokens;
     
     // Add history to the request / 将历史记录添加到请求中
-    for (const auto& pair : ctx.history) {
-        messages.push_back({{"role", "user"}, {"content", pair.first.toStdString()}});
-        messages.push_back({{"role", "assistant"}, {"content", pair.second.toStdString()}});
+    for (size_t i = firstRound; i < rounds; ++i) {
+        const auto& pair = context.history[i];
+        messages.push_back({"user", pair.first});
+        messages.push_back({"assistant", pair.second});
     }
 
-    QString currentUserContent = m_config.pre_prompt + processedText;
-    messages.push_back({{"role", "user"}, {"content", currentUserContent.toStdString()}});
+    messages.push_back({"user", finalUserContent});
+    emit logMessage(QString(SV_PROMPT_SIZE[m_config.language]).arg(promptTokens).arg(rounds - firstRound).arg(rounds));
+
+    // 4. Send Request and Wait for Result / 发送请求并等待结果
+    // New terms <tm> are extracted from the full reply; when streaming this happens after we return
+    // 新术语 <tm> 从完整回复中提取；流式模式下该步骤在本函数返回之后进行
+    std::function<void(const QString&)> onFullContent;
+    if (performExtraction) {
+        onFullContent = [this, processedText](const QString& fullContent) {
+            extractNewTerms(fullContent, processedText);
+        };
+    }
+    QString rawContent = requestCompletion(messages, apiKey, onFullContent, status, timeoutMs);
+    if (rawContent.isEmpty()) {
+        return ""; // Error already logged; return empty to trigger retry / 错误已记录，返回空以触发重试
+    }
+
+    QString resultText = ""; // Translation result, default empty / 翻译结果，默认空
+
+    // 5. Parse/Extract Result / 解析/提取结果
+    if (performExtraction) {
+        // Extract <tl> tag content / 提取 <tl> 标签内容
+        qsizetype pos = 0;
+        QStringView tl;
+        if (kTlTag.nextBlock(rawContent, pos, tl)) {
+            resultText = tl.trimmed().toString();
+        } else {
+            // Attempt cleaning if tag is missing / 尝试清洗非标签内容
+            resultText = TagScanner::removeAllTags(rawContent); // Remove all tags / 移除所有标签
+            emit logMessage(SV_WARN_TAG[m_config.language]); 
+        }
+    } else {
+        // Mode B: Normal translation (remove <think> tag) / 模式 B: 普通翻译（移除 <think> 标签）
+        resultText = kThinkTag.strip(rawContent).trimmed();
+    }
+
+    // 6. Regex Post-processing / 正则后处理
+    if (m_config.enable_glossary) {
+        resultText = RegexManager::instance().processPost(resultText);
+    }
 
-    // 5. Prepare API Request Payload / 准备 API 请求 Payload
-    json payload;
-    payload["model"] = m_config.model_name.toStdString();
-    payload["messages"] = messages;
-    payload["temperature"] = m_config.temperature;
+    emit logMessage("  -> " + resultText); 
+
+    // Only save valid translation result to context / 只有通过校验的翻译结果才保存到上下文
+    bool isValidResult = isValidTranslationResult(resultText);
+
+    if (isValidResult) {
+        // Save to context history / 保存到上下文历史
+        if (!stateless) m_contexts.commit(contextId, context, m_config.context_num, currentUserContent, resultText);
+    } else {
+        // If result is invalid, force empty / 如果结果被判定为无效，强制清空，不返回
+        resultText = ""; 
+    }
+
+    return resultText; // Return empty string to trigger retry or 500 status code / 返回空字符串以触发重试或 500 状态码
+}
+
+/**
+ * @brief Turns a timeout forced by the request deadline into a cancellation
+ * @brief 将因请求截止时间而提前触发的超时视为取消
+ * @details When the attempt's timeout was cut below UPSTREAM_TIMEOUT_MS by the deadline, running out of
+ *          time is our decision, not a sign of a broken endpoint or key (breaker and key stay untouched)
+ * @details 当截止时间把本次尝试的超时缩短到 UPSTREAM_TIMEOUT_MS 以下时，超时是本地的决定，
+ *          并不说明端点或密钥有问题 (熔断器与密钥均不受影响)
+ */
+static UpstreamResponse chargeDeadline(UpstreamResponse reply, bool cutByDeadline) {
+    if (reply.timedOut && cutByDeadline) {
+        reply.timedOut = false;
+        reply.error = QNetworkReply::OperationCanceledError;
+        reply.errorString = "Request deadline reached";
+    }
+    return reply;
+}
+
+/**
+ * @brief Sends one chat/completions request and returns the raw assistant content
+ * @brief 发送一次 chat/completions 请求并返回模型的原始回复内容
+ * @details Returns an empty string on timeout, network, HTTP or format errors (already logged)
+ * @details 超时、网络、HTTP 或格式错误时返回空字符串 (错误已记录到日志)
+ */
+QString TranslationServer::requestCompletion(const std::vector<ChatMessage>& messages, const QString& apiKey,
+                                             const std::function<void(const QString&)>& onFullContent,
+                                             AttemptStatus* status, int timeoutMs) {
+    // Circuit open: do not even try, the retry loop stops on this / 熔断已打开：不再尝试，重试循环据此停止
+    CircuitBreaker::Ticket admission = m_breaker.allowRequest();
+    if (!admission) {
+        // The caller acquired this key for nothing; hand it back untouched / 调用方白白占用了该密钥，原样归还
+        m_keyScheduler.release(apiKey, ApiKeyScheduler::Outcome::Cancelled, 0);
+        if (status) status->circuitOpen = true;
+        return "";
+    }
+
+    // 1. Prepare API Request Payload, serialized directly without a JSON document
+    // 准备 API 请求 Payload，直接序列化，不构建 JSON 文档
+    JsonWriter& payload = JsonWriter::forThread();
+    payload.beginObject();
+    payload.key("model");
+    payload.value(m_config.model_name);
+    payload.key("messages");
+    payload.beginArray();
+    for (const ChatMessage& message : messages) {
+        payload.beginObject();
+        payload.key("role");
+        payload.value(message.role);
+        payload.key("content");
+        payload.value(message.content);
+        payload.endObject();
+    }
+    payload.endArray();
+    payload.key("temperature");
+    payload.value(m_config.temperature);
+    if (m_config.enable_streaming) {
+        payload.key("stream");
+        payload.value(true);
+        // Ask for a final usage chunk / 请求在流末尾附带 usage 块
+        payload.key("stream_options");
+        payload.beginObject();
+        payload.key("include_usage");
+        payload.value(true);
+        payload.endObject();
+    }
+    payload.endObject();
 
-    QNetworkAccessManager manager;
     QNetworkRequest request(QUrl(m_config.api_address + "/chat/completions"));
     // Set headers / 设置头部
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
     request.setRawHeader("Authorization", ("Bearer " + apiKey).toUtf8());
+    QByteArray body = payload.toByteArray();
 
-    // Set timeout (Qt 6.x) / 设置超时 (Qt 6.x)
-    request.setTransferTimeout(30000); // 30 seconds timeout / 30秒超时
-
-    // 6. Send Request and Wait for Result (Using QEventLoop for synchronous call simulation)
-    // 发送请求并等待结果 (使用 QEventLoop 模拟同步调用)
-    QNetworkReply* reply = manager.post(request, QByteArray::fromStdString(payload.dump()));
-    
-    QEventLoop loop;
-    QTimer timer;
-    timer.setSingleShot(true);
-    
-    // Connect timeout signal and finished signal / 连接超时信号，并连接请求完成信号
-    QObject::connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
-    QObject::connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
-    
-    timer.start(30000); // Start 30 seconds timer / 启动 30 秒超时计时器
-    loop.exec(); // Block and wait / 阻塞等待
-
-    QString resultText = ""; // Translation result, default empty / 翻译结果，默认空
+    if (m_config.enable_streaming) {
+        return requestCompletionStreaming(request, body, apiKey, admission, onFullContent, status, timeoutMs);
+    }
 
-    // Check for timeout / 检查是否超时
-    if (!timer.isActive()) {
-        emit logMessage("❌ 请求超时 (Request Timeout)");
-        reply->abort(); // Abort request / 终止请求
-        reply->deleteLater();
-        return ""; // Timeout returns empty / 超时返回空
+    // 2. Submit to the shared upstream client and wait (connections are pooled and kept alive)
+    // 提交给共享的上游客户端并等待结果 (连接会被复用并保持长连接)
+    QElapsedTimer latency;
+    latency.start();
+    std::future<UpstreamResponse> pending = m_upstream.post(request, body, timeoutMs);
+    UpstreamResponse reply = chargeDeadline(pending.get(), timeoutMs < UPSTREAM_TIMEOUT_MS); // Block and wait (at most timeoutMs) / 阻塞等待 (最多 timeoutMs)
+    reportUpstreamResult(apiKey, admission, reply, latency.elapsed());
+    if (status) {
+        status->outcome = ApiKeyScheduler::classify(reply);
+        status->httpStatus = reply.httpStatus;
     }
-    timer.stop(); // Stop timer / 停止计时器
 
-    // 7. Process Network Response / 处理网络响应
-    if (reply->error() == QNetworkReply::NoError) {
-        QByteArray responseBytes = reply->readAll();
+    QString rawContent = "";
+
+    // 3. Process Network Response / 处理网络响应
+    if (reply.error == QNetworkReply::NoError && !reply.timedOut) {
+        const QByteArray& responseBytes = reply.body;
         try {
             json response = json::parse(responseBytes.toStdString());
             // Check for "choices" field and if not empty / 检查是否存在 "choices" 字段且不为空
             if (response.contains("choices") && !response["choices"].empty()) {
                 std::string content = response["choices"][0]["message"]["content"];
-                QString rawContent = QString::fromStdString(content);
-
-                // 8. Parse/Extract Result / 解析/提取结果
-                if (performExtraction) {
-                    // Extract <tl> tag content / 提取 <tl> 标签内容
-                    QRegularExpression reTl("<tl>(.*?)</tl>", QRegularExpression::DotMatchesEverythingOption);
-                    QRegularExpressionMatch matchTl = reTl.match(rawContent);
-                    if (matchTl.hasMatch()) {
-                        resultText = matchTl.captured(1).trimmed();
-                    } else {
-                        // Attempt cleaning if tag is missing / 尝试清洗非标签内容
-                        resultText = rawContent;
-                        resultText.remove(QRegularExpression("<[^>]*>")); // Remove all tags / 移除所有标签
-                        emit logMessage(SV_WARN_TAG[m_config.language]); 
-                    }
-
-                    // Extract new terms <tm> / 提取新术语 <tm>
-                    QRegularExpression reTm("<tm>(.*?)</tm>");
-                    QRegularExpressionMatchIterator i = reTm.globalMatch(rawContent);
-                    while (i.hasNext()) {
-                        QRegularExpressionMatch match = i.next();
-                        QString termLine = match.captured(1).trimmed();
-                        int eqIdx = termLine.indexOf('=');
-                        if (eqIdx > 0) {
-                            QString k = termLine.left(eqIdx).trimmed();
-                            QString v = termLine.mid(eqIdx + 1).trimmed();
-                            // Only save if the original text contains the term / 只有原文包含该术语，才保存
-                            if (processedText.contains(k, Qt::CaseInsensitive)) {
-                                GlossaryManager::instance().addNewTerm(k, v);
-                                emit logMessage(QString(SV_NEW_TERM[m_config.language]) + k + " = " + v);
-                            }
-                        }
-                    }
-                } else {
-                    // Mode B: Normal translation (remove <think> tag) / 模式 B: 普通翻译（移除 <think> 标签）
-                    resultText = rawContent;
-                    std::regex think_regex("<think>.*?</think>", std::regex_constants::ECMAScript | std::regex_constants::icase);
-                    std::string filtered = std::regex_replace(resultText.toStdString(), think_regex, "");
-                    resultText = QString::fromStdString(filtered).trimmed();
-                }
-
-                // 9. Regex Post-processing / 正则后处理
-                if (m_config.enable_glossary) {
-                    resultText = RegexManager::instance().processPost(resultText);
-                }
-
-                emit logMessage("  -> " + resultText); 
-
-                // Only save valid translation result to context / 只有通过校验的翻译结果才保存到上下文
-                bool isValidResult = isValidTranslationResult(resultText);
-
-                if (isValidResult) {
-                    // Save to context history / 保存到上下文历史
-                    ctx.history.push_back({currentUserContent, resultText});
-                    while (ctx.history.size() > ctx.max_len) ctx.history.pop_front();
-                } else {
-                    // If result is invalid, force empty / 如果结果被判定为无效，强制清空，不返回
-                    resultText = ""; 
-                }
+                rawContent = QString::fromStdString(content);
+                if (response.contains("usage")) recordUsage(TokenManager::parseUsage(response["usage"]));
             } else {
                 // Response JSON missing choices field (Format Error) / 响应 JSON 中缺少 choices 字段 (格式错误)
                 QString err = SV_ERR_FMT[m_config.language];
                 emit logMessage("❌ " + err + " (API Response: " + QString::fromStdString(responseBytes.toStdString()) + ")");
-                resultText = ""; // Format error, return empty / 格式错误，返回空
             }
         } catch (const std::exception& e) {
             // JSON parsing exception / JSON 解析异常
             QString err = SV_ERR_JSON[m_config.language];
             emit logMessage("❌ " + err + " (Exception: " + QString(e.what()) + ")");
-            resultText = ""; // JSON error, return empty / JSON 错误，返回空
         } catch (...) {
             // Other unknown parsing error / 其他未知解析错误
             QString err = SV_ERR_JSON[m_config.language];
             emit logMessage("❌ " + err + " (Unknown parsing error)");
-            resultText = ""; // JSON error, return empty / JSON 错误，返回空
         }
     } else {
-        // Network Error Handling (e.g., 429 Too Many Requests) / 网络错误处理 (如 429 Too Many Requests)
-        QString errStr = reply->errorString();
-        // Get HTTP status code / 获取 HTTP 状态码
-        int httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-        
-        QString errorMsg = "❌ 网络请求失败: ";
-        if (httpStatus > 0) {
-            errorMsg += QString("HTTP %1 - ").arg(httpStatus);
+        logUpstreamFailure(reply);
+    }
+
+    if (onFullContent && !rawContent.isEmpty()) {
+        onFullContent(rawContent);
+    }
+    return rawContent;
+}
+
+/**
+ * @brief Sends a stream=true request and returns as soon as the content is usable
+ * @brief 发送 stream=true 请求，内容一旦可用立即返回
+ * @details The caller gets the content right after </tl> (when onFullContent is set, i.e. term
+ *          extraction is on) or when the content finishes; onFullContent then runs on the network
+ *          thread once the whole stream has arrived.
+ * @details 调用方在收到 </tl> 后 (设置了 onFullContent，即开启术语提取时) 或内容结束时立即拿到结果；
+ *          整个流到达后，onFullContent 会在网络线程上执行。
+ */
+QString TranslationServer::requestCompletionStreaming(const QNetworkRequest& request, const QByteArray& body,
+                                                      const QString& apiKey, const CircuitBreaker::Ticket& admission,
+                                                      const std::function<void(const QString&)>& onFullContent,
+                                                      AttemptStatus* status, int timeoutMs) {
+    auto stream = std::make_shared<StreamingCompletion>(bool(onFullContent));
+    std::future<QString> early = stream->earlyResult();
+
+    // The key stays in flight until the whole stream has arrived, but its latency (and the breaker's)
+    // is what the caller waited: up to the early result. Both callbacks run on the network thread.
+    // 整个流到达前，密钥一直计为进行中；但密钥与熔断器的延迟按调用方实际等待的时间 (到早期结果为止) 计算。
+    // 两个回调都在网络线程上执行。
+    auto latency = std::make_shared<QElapsedTimer>();
+    latency->start();
+    auto earlyMs = std::make_shared<qint64>(-1);
+    std::future<UpstreamResponse> pending = m_upstream.postStreaming(request, body, timeoutMs,
+        [stream, latency, earlyMs](const QByteArray& chunk) {
+            stream->feed(chunk);
+            if (*earlyMs < 0 && stream->published()) *earlyMs = latency->elapsed();
+        },
+        [this, stream, onFullContent, apiKey, admission, latency, earlyMs, timeoutMs](const UpstreamResponse& finished) {
+            const UpstreamResponse reply = chargeDeadline(finished, timeoutMs < UPSTREAM_TIMEOUT_MS);
+            reportUpstreamResult(apiKey, admission, reply, *earlyMs >= 0 ? *earlyMs : latency->elapsed());
+            bool ok = reply.error == QNetworkReply::NoError && !reply.timedOut;
+            QString fullContent = stream->finish(ok);
+            if (ok) recordUsage(stream->usage());
+            // Term extraction continues here, after the translation was already returned
+            // 术语提取在此继续进行，此时译文早已返回
+            if (ok && onFullContent && !fullContent.isEmpty()) onFullContent(fullContent);
+        });
+
+    // The early result is normally set before the request's own future; should the request end
+    // without it, stop waiting as soon as the request itself has finished
+    // 早期结果通常先于请求自身的 future 被设置；若请求结束时仍未设置，则在请求完成后停止等待
+    while (early.wait_for(std::chrono::milliseconds(EARLY_RESULT_POLL_MS)) != std::future_status::ready) {
+        if (pending.wait_for(std::chrono::milliseconds(0)) == std::future_status::ready) break;
+    }
+    QString rawContent = early.wait_for(std::chrono::milliseconds(0)) == std::future_status::ready ? early.get() : QString();
+    if (!rawContent.isEmpty()) return rawContent;
+
+    // Nothing usable: the stream has ended, find out why / 没有可用内容：流已结束，查明原因
+    UpstreamResponse reply = chargeDeadline(pending.get(), timeoutMs < UPSTREAM_TIMEOUT_MS);
+    if (status) {
+        status->outcome = ApiKeyScheduler::classify(reply);
+        status->httpStatus = reply.httpStatus;
+    }
+    if (reply.error != QNetworkReply::NoError || reply.timedOut) {
+        logUpstreamFailure(reply);
+    } else {
+        QString err = SV_ERR_FMT[m_config.language];
+        QString detail = stream->errorEvent().isEmpty() ? QString("empty stream") : stream->errorEvent();
+        emit logMessage("❌ " + err + " (API Response: " + detail + ")");
+    }
+    return "";
+}
+
+/**
+ * @brief Reports the API's token usage of one call
+ * @brief 上报 API 返回的单次调用 Token 用量
+ */
+void TranslationServer::recordUsage(const TokenUsage& usage) {
+    if (!usage.valid) return;
+    m_usagePromptTokens.fetch_add(usage.prompt, std::memory_order_relaxed);
+    m_usageCachedTokens.fetch_add(usage.cached, std::memory_order_relaxed);
+    emit tokenUsageReceived(usage.prompt, usage.completion);
+}
+
+/**
+ * @brief Logs a failed upstream call (timeout or network/HTTP error)
+ * @brief 记录失败的上游调用 (超时或网络/HTTP 错误)
+ */
+void TranslationServer::logUpstreamFailure(const UpstreamResponse& reply) {
+    // Check for timeout / 检查是否超时
+    if (reply.timedOut) {
+        emit logMessage("❌ 请求超时 (Request Timeout)");
+        return;
+    }
+    // Network Error Handling (e.g., 429 Too Many Requests) / 网络错误处理 (如 429 Too Many Requests)
+    QString errorMsg = "❌ 网络请求失败: ";
+    if (reply.httpStatus > 0) {
+        errorMsg += QString("HTTP %1 - ").arg(reply.httpStatus);
+    }
+    errorMsg += reply.errorString;
+
+    emit logMessage(errorMsg);
+}
+
+/**
+ * @brief Saves the new proper nouns the model reported in <tm> tags
+ * @brief 保存模型在 <tm> 标签中报告的新专有名词
+ */
+void TranslationServer::extractNewTerms(const QString& rawContent, const QString& processedText) {
+    qsizetype pos = 0;
+    QStringView block;
+    while (kTmTag.nextBlock(rawContent, pos, block)) {
+        QString termLine = block.trimmed().toString();
+        int eqIdx = termLine.indexOf('=');
+        if (eqIdx > 0) {
+            QString k = termLine.left(eqIdx).trimmed();
+            QString v = termLine.mid(eqIdx + 1).trimmed();
+            // Only save if the original text contains the term / 只有原文包含该术语，才保存
+            if (SimdSearch::contains(processedText, k)) {
+                GlossaryManager::instance().addNewTerm(k, v);
+                emit logMessage(QString(SV_NEW_TERM[m_config.language]) + k + " = " + v);
+            }
         }
-        errorMsg += errStr;
-        
-        emit logMessage(errorMsg);
-        resultText = ""; // Network error, return empty / 网络错误，返回空
     }
+}
 
-    reply->deleteLater();
-    return resultText; // Return empty string to trigger retry or 500 status code / 返回空字符串以触发重试或 500 状态码
+/**
+ * @brief Takes the key with the most headroom from the scheduler
+ * @brief 从调度器取出余量最大的密钥
+ */
+QString TranslationServer::acquireApiKey(const QSet<QString>& excluded) {
+    qint64 waitMs = -1;
+    QString key = m_keyScheduler.acquire(excluded, &waitMs);
+    if (!key.isEmpty()) return key;
+
+    if (m_keyScheduler.keyCount() == 0 || waitMs < 0) {
+        QString err = SV_ERR_KEY[m_config.language];
+        emit logMessage("❌ " + err + " (No API Key Available)");
+    } else {
+        emit logMessage(QString(SV_KEYS_COOLING[m_config.language]).arg((waitMs + 999) / 1000));
+    }
+    return "";
 }
 
 /**
- * @brief Get the next available API key (Round-Robin strategy)
- * @brief 获取下一个可用的 API 密钥 (轮询策略)
+ * @brief Reports the outcome of a call back to the key scheduler and the circuit breaker
+ * @brief 将调用结果反馈给密钥调度器和熔断器
  */
-QString TranslationServer::getNextApiKey() {
-    std::lock_guard<std::mutex> lock(m_keyMutex); // Lock to protect key rotation / 锁保护密钥轮询
-    if (m_apiKeys.empty()) return ""; // No keys, return empty / 没有密钥，返回空
-    QString key = m_apiKeys[m_currentKeyIndex];
-    // Circularly move index / 循环移动索引
-    m_currentKeyIndex = (m_currentKeyIndex + 1) % m_apiKeys.size();
-    return key;
+void TranslationServer::reportUpstreamResult(const QString& apiKey, const CircuitBreaker::Ticket& admission,
+                                             const UpstreamResponse& reply, qint64 latencyMs) {
+    ApiKeyScheduler::Outcome outcome = ApiKeyScheduler::classify(reply);
+    // Only outages (no response, timeout, 5xx) count against the endpoint; 401/429 are per-key
+    // problems and other 4xx are caused by the request itself
+    // 只有故障 (无响应、超时、5xx) 才计入端点健康；401/429 属于单个密钥的问题，其他 4xx 由请求本身导致
+    CircuitBreaker::Result health = CircuitBreaker::Result::Ignored;
+    if (outcome == ApiKeyScheduler::Outcome::Success) health = CircuitBreaker::Result::Success;
+    else if (outcome == ApiKeyScheduler::Outcome::ServerError || outcome == ApiKeyScheduler::Outcome::NetworkError)
+        health = CircuitBreaker::Result::Failure;
+    // Time spent queued for a local connection says nothing about the endpoint / 本地排队等待连接的时间与端点无关
+    const qint64 serviceMs = std::max<qint64>(0, latencyMs - reply.queuedMs);
+    m_breaker.record(admission, health, serviceMs);
+
+    auto change = m_keyScheduler.release(apiKey, outcome, serviceMs, reply.headers);
+    if (change == ApiKeyScheduler::KeyChange::CoolingDown) {
+        emit logMessage(QString(SV_KEY_COOLDOWN[m_config.language]).arg(ApiKeyScheduler::maskKey(apiKey)));
+    } else if (change == ApiKeyScheduler::KeyChange::Quarantined) {
+        emit logMessage(QString(SV_KEY_QUARANTINE[m_config.language]).arg(ApiKeyScheduler::maskKey(apiKey)));
+    }
+}
+
+/**
+ * @brief Builds the persistent cache key for a request
+ * @brief 为请求生成持久化缓存键
+ * @details The glossary state is captured through the terms this text contains, so newly learned
+ *          terms only invalidate the lines they actually affect. All contained terms are used (not
+ *          the ranked, budgeted selection) so the key does not drift as usage counts change.
+ * @details 术语表状态通过本句包含的术语来体现，新学到的术语只会使真正受影响的文本失效。
+ *          这里使用全部包含的术语 (而非排序截断后的子集)，使缓存键不随使用频率变化而漂移。
+ */
+QByteArray TranslationServer::buildCacheKey(const QString& text, const QString& processedText) {
+    QString normalized = TranslationCache::normalize(text);
+    QString glossaryContext;
+    QByteArray regexDigest;
+    if (m_config.enable_glossary) {
+        glossaryContext = GlossaryManager::instance().getMatchedTerms(processedText);
+        // Regex rules rewrite the source and the result, so editing them must miss old entries
+        // 正则规则会改写原文与译文，修改规则后旧的缓存条目不应再命中
+        regexDigest = RegexManager::instance().digest();
+    }
+    return TranslationCache::makeKey(normalized, m_config.model_name, m_config.system_prompt,
+                                     m_config.pre_prompt, glossaryContext, regexDigest);
 }
 
 /**
@@ -449,4 +1154,30 @@ QString TranslationServer::generateClientId(const std::string& ip) {
     // Hash IP using MD5 and take the first 8 hex characters / 使用 MD5 哈希 IP 并取前 8 位十六进制字符
     QByteArray hash = QCryptographicHash::hash(QByteArray::fromStdString(ip), QCryptographicHash::Md5);
     return hash.toHex().left(8);
+}
+
+/**
+ * @brief Builds the context key of a request
+ * @brief 生成请求的上下文键
+ * @details With context_key_param set (e.g. a scene or speaker), each value of that header or query
+ *          parameter gets its own history per client; requests without it share the client's history.
+ * @details 设置 context_key_param (如场景或说话人) 后，该请求头或查询参数的每个取值在同一客户端下
+ *          各自拥有独立的历史；未携带该值的请求共用客户端的历史。
+ */
+QString TranslationServer::contextKeyFor(const httplib::Request& req) {
+    QString key = generateClientId(req.remote_addr);
+    const std::string param = m_config.context_key_param.trimmed().toStdString();
+    if (param.empty()) return key;
+
+    std::string scope;
+    if (req.has_header(param)) scope = req.get_header_value(param);
+    else if (req.has_param(param)) scope = req.get_param_value(param);
+    if (scope.empty()) return key;
+
+    // Long values are hashed so a key stays small / 过长的取值取哈希，使键保持简短
+    QByteArray value = QByteArray::fromStdString(scope);
+    if (value.size() > MAX_CONTEXT_SCOPE_LENGTH) {
+        value = QCryptographicHash::hash(value, QCryptographicHash::Md5).toHex();
+    }
+    return key + '/' + QString::fromUtf8(value);
 }
\ No newline at end of file
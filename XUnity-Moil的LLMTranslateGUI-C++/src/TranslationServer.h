@@ -3,40 +3,54 @@
 #include <QThread>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
+#include <QThreadPool>
+#include <QTimer>
+#include <QDeadlineTimer>
 #include <deque>
+#include <vector>
 #include <mutex>
-#include <map>
 #include <atomic>
-// #include <future>             // [Commented Out/已注释]
-// #include <condition_variable> // [Commented Out/已注释]
+#include <future>
+#include <condition_variable>
+#include <functional>
 #include "ConfigManager.h"
+#include "TranslationCache.h"
+#include "SingleFlight.h"
+#include "UpstreamClient.h"
+#include "ApiKeyScheduler.h"
+#include "RetryPolicy.h"
+#include "CircuitBreaker.h"
+#include "ContextStore.h"
+#include "TokenManager.h"
 #include "httplib.h"
+#include "json.hpp"
 
 /**
- * @brief Conversation Context Structure
- * @brief 对话上下文结构体
+ * @brief One Chat Message of a Request
+ * @brief 请求中的一条对话消息
  *
- * Stores the chat history for a specific client to enable continuous conversation.
- * 存储特定客户端的聊天记录，以实现连续对话（上下文记忆）功能。
+ * Holds the content as QString (implicitly shared with the context history); it is serialized
+ * straight into the request body by JsonWriter.
+ * 内容以 QString 保存 (与上下文历史隐式共享)，由 JsonWriter 直接序列化到请求体中。
  */
-struct Context {
-    // Stores pairs of (User Input, Assistant Response)
-    // 存储 (用户输入, AI助手回复) 的成对历史
-    std::deque<std::pair<QString, QString>> history;
-    
-    // Maximum number of context rounds to keep
-    // 保留的最大上下文轮数
-    int max_len;
+struct ChatMessage {
+    const char* role; // "system" / "user" / "assistant"
+    QString content;
 };
 
-/* [Commented Out] Pending Request Structure for Batch Processing
-   [已注释] 用于批量处理的待处理请求结构
+/**
+ * @brief Pending Request Structure for Batch Processing
+ * @brief 用于批量处理的待处理请求结构
+ *
+ * One queued line waiting to be sent as part of a numbered multi-line prompt.
+ * 一条排队等待的文本，将作为编号多行提示词的一部分发送。
+ */
 struct PendingRequest {
     QString originalText;
-    QString clientIP;
+    QString processedText; // After regex pre-processing / 正则预处理之后的文本
+    QDeadlineTimer deadline; // request_deadline_ms, counted from arrival / 从到达时开始计算的请求截止时间
     std::shared_ptr<std::promise<QString>> prom;
 };
-*/
 
 /**
  * @brief Translation Server Logic Class
@@ -64,66 +78,183 @@ public:
     // 停止 HTTP 监听线程并清理资源
     void stopServer();
 
+    // Human-readable runtime statistics (cache counters etc.)
+    // 可读的运行时统计信息 (缓存计数等)
+    QString statsReport() const;
+
 signals:
     // Signal to send logs to the UI main thread
     // 用于发送日志消息到 UI 主线程的信号 (跨线程通信)
     void logMessage(QString msg);
 
+    // Circuit breaker state changed (CircuitBreaker::State as int)
+    // 熔断器状态变化 (CircuitBreaker::State 转为 int)
+    void circuitStateChanged(int state);
+
+    // Token usage reported by the API for one call
+    // API 返回的单次调用 Token 用量
+    void tokenUsageReceived(long long prompt, long long completion);
+
 private:
     // Main loop for the httplib server (runs in a separate thread)
     // httplib 服务器的主循环 (在单独的 std::thread 中运行，不阻塞 Qt UI)
     void runServerLoop(); 
     
-    // void runBatchProcessor(); // [Commented Out/已注释]
+    // Batch collector loop: gathers requests for batch_window_ms or up to batch_max_lines
+    // 批量收集循环：在 batch_window_ms 时间窗口内或凑满 batch_max_lines 条后打包请求
+    void runBatchProcessor();
 
-    // Core function: Sends request to AI API and parses response
-    // 核心函数：构建提示词、发送请求给 AI API 并解析返回结果 (包含重试逻辑)
-    QString performTranslation(const QString& text, const QString& clientIP);
+    // Queue one line for batching and wait for its translation
+    // 将一条文本加入批量队列并等待其译文
+    QString enqueueBatch(const QString& text, const QString& processedText);
+
+    // Core function: Sends request to AI API and parses response; gives up at the deadline.
+    // An empty contextKey translates statelessly (no history, no term extraction), as batch mode does
+    // 核心函数：构建提示词、发送请求给 AI API 并解析返回结果 (包含重试逻辑)；到达截止时间后放弃。
+    // contextKey 为空时无状态翻译 (不带历史、不提取术语)，与批量模式一致
+    QString performTranslation(const QString& text, const QString& processedText, const QString& contextKey,
+                               QDeadlineTimer deadline);
+
+    // Deadline of a request arriving now (request_deadline_ms, Forever if <= 0)
+    // 此刻到达的请求的截止时间 (request_deadline_ms，≤ 0 时为 Forever)
+    QDeadlineTimer requestDeadline() const;
     
-    // void processBatch(std::vector<std::shared_ptr<PendingRequest>>& batch); // [Commented Out/已注释]
+    // Translate a batch with one numbered multi-line prompt, falling back per line on mismatch
+    // 用一个编号多行提示词翻译整批文本，结果对不上时逐条回退
+    void processBatch(std::vector<std::shared_ptr<PendingRequest>>& batch);
+
+    // Send one chat/completions request and return the raw assistant content ("" on failure).
+    // onFullContent receives the complete reply; in streaming mode it may run after this returns.
+    // 发送一次 chat/completions 请求并返回原始回复内容 (失败返回空)。
+    // onFullContent 接收完整回复；流式模式下它可能在本函数返回之后才执行。
+    // `status` (optional) receives the upstream outcome for the retry policy.
+    // `status` (可选) 接收上游调用结果，供重试策略使用。
+    QString requestCompletion(const std::vector<ChatMessage>& messages, const QString& apiKey,
+                              const std::function<void(const QString&)>& onFullContent = nullptr,
+                              AttemptStatus* status = nullptr, int timeoutMs = UPSTREAM_TIMEOUT_MS);
+
+    // Streaming (SSE) variant of requestCompletion / requestCompletion 的流式 (SSE) 版本
+    QString requestCompletionStreaming(const QNetworkRequest& request, const QByteArray& body, const QString& apiKey,
+                                       const CircuitBreaker::Ticket& admission,
+                                       const std::function<void(const QString&)>& onFullContent,
+                                       AttemptStatus* status, int timeoutMs);
+
+    // Stats lines of the `limit` most expensive regex passes / 耗时最多的 limit 个正则阶段的统计行
+    QStringList regexStatsLines(int limit) const;
+
+    // Log a failed upstream call / 记录失败的上游调用
+    void logUpstreamFailure(const UpstreamResponse& reply);
+
+    // Save new terms reported in <tm> tags (only those present in the source text)
+    // 保存 <tm> 标签中报告的新术语 (仅限原文中出现的)
+    void extractNewTerms(const QString& rawContent, const QString& processedText);
 
-    // Get the next available API key (Round-Robin strategy)
-    // 获取下一个可用的 API 密钥 (轮询策略，用于负载均衡)
-    QString getNextApiKey();
+    // Get the API key with the most headroom ("" and a log line if none is usable)
+    // 获取余量最大的 API 密钥 (没有可用密钥时返回空并记录日志)
+    QString acquireApiKey(const QSet<QString>& excluded = QSet<QString>());
+
+    // Report a finished call to the key scheduler (cool-down / quarantine) and the circuit breaker
+    // (admission is the breaker ticket the call was let through with)
+    // 将完成的调用反馈给密钥调度器 (冷却 / 隔离) 和熔断器 (admission 为放行该调用的熔断器凭证)
+    void reportUpstreamResult(const QString& apiKey, const CircuitBreaker::Ticket& admission,
+                              const UpstreamResponse& reply, qint64 latencyMs);
+
+    // Forward the usage of a finished call to the UI and the prompt cache counters
+    // 将已完成调用的用量转发给界面并计入提示词缓存统计
+    void recordUsage(const TokenUsage& usage);
+
+    // Build the persistent cache key for a request (text + model + prompts + glossary state + regex rules)
+    // 为请求生成持久化缓存键 (原文 + 模型 + 提示词 + 术语表状态 + 正则规则)
+    QByteArray buildCacheKey(const QString& text, const QString& processedText);
 
     // Generate a simplified Client ID based on IP hash
     // 基于 IP 地址的哈希值生成简化的客户端 ID，用于区分不同用户的上下文
     QString generateClientId(const std::string& ip);
 
+    // Context key of a request: the client ID, optionally refined by the context_key_param header / query parameter
+    // 请求的上下文键：客户端 ID，可选地由 context_key_param 指定的请求头 / 查询参数进一步细分
+    QString contextKeyFor(const httplib::Request& req);
+
+    // Upper bound of a single upstream call / 单次上游调用的时间上限
+    static constexpr int UPSTREAM_TIMEOUT_MS = 30000;
+    // A retry is only started with at least this much time left before the request deadline
+    // 距请求截止时间至少还剩这么多时间时才发起重试
+    static constexpr int MIN_ATTEMPT_BUDGET_MS = 5000;
+    // Estimated tokens a chat message adds besides its content (role, separators)
+    // 每条对话消息除内容外额外占用的估算 Token 数 (角色、分隔符)
+    static constexpr int MESSAGE_TOKEN_OVERHEAD = 4;
+    // Longer context_key_param values are replaced by their hash / 超过此长度的 context_key_param 取值以哈希代替
+    static constexpr int MAX_CONTEXT_SCOPE_LENGTH = 64;
+    // How often a streaming call checks whether the request ended without an early result
+    // 流式调用检查请求是否在没有早期结果的情况下结束的间隔
+    static constexpr int EARLY_RESULT_POLL_MS = 50;
+    // Interval of the regex profile log (regex_profiling only) / 正则性能分析日志的输出间隔 (仅 regex_profiling)
+    static constexpr int REGEX_PROFILE_INTERVAL_MS = 60000;
+
     AppConfig m_config;
     std::atomic<bool> m_running;            // Thread-safe running flag / 线程安全的运行标志
+    // Lets retry back-off sleeps end as soon as the server stops / 让重试退避休眠在服务停止时立即结束
+    std::mutex m_stopMutex;
+    std::condition_variable m_stopCv;
     std::thread* m_serverThread = nullptr;  // Pointer to the server thread / 指向 HTTP 服务器线程的指针
-    // std::thread* m_batchThread = nullptr; // [Commented Out/已注释]
+    std::thread* m_batchThread = nullptr;   // Batch collector thread (batch mode only) / 批量收集线程 (仅批量模式)
     
     httplib::Server* m_svr = nullptr;       // The actual HTTP server instance / 实际的 httplib 服务器实例
 
-    /* [Commented Out] Batch processing queue
-       [已注释] 批量处理队列
+    // Batch processing queue / 批量处理队列
     std::deque<std::shared_ptr<PendingRequest>> m_requestQueue;
     std::mutex m_queueMutex;
     std::condition_variable m_queueCv;
-    */
+    std::atomic<bool> m_batchRunning{false};
 
-    // Context Storage: Map ClientID -> Context
-    // 上下文存储：映射 ClientID -> 上下文结构体
-    std::map<std::string, Context> m_contexts;
-    
-    // Mutex to protect context map from concurrent access
-    // 互斥锁，保护 m_contexts 免受多线程并发访问冲突
-    std::mutex m_contextMutex; 
+    // Workers that send collected batches upstream / 负责将收集好的批次发送到上游的工作线程
+    QThreadPool m_batchPool;
+
+    // Context Storage: ContextKey -> Context (sharded, internally locked, never locked across a network call)
+    // 上下文存储：上下文键 -> 上下文结构体 (分片、内部自带锁、网络请求期间从不持锁)
+    ContextStore m_contexts;
     
     // API Key Management
     // API 密钥管理
-    std::vector<QString> m_apiKeys;
-    int m_currentKeyIndex = 0;
-    std::mutex m_keyMutex;     // Protects key rotation / 保护密钥轮询索引
+    // Picks keys by headroom, cools down rate-limited ones and quarantines rejected ones (internally locked)
+    // 按余量分配密钥，冷却被限流的密钥并隔离被拒绝的密钥 (内部自带锁)
+    ApiKeyScheduler m_keyScheduler;
+
+    // Stops calling a failing API for a while and fails requests fast instead (internally locked)
+    // API 持续失败时暂停调用并让请求快速失败 (内部自带锁)
+    CircuitBreaker m_breaker;
+
+    // Shared upstream HTTP client (pooled, keep-alive connections on a network thread)
+    // 共享的上游 HTTP 客户端 (在网络线程上复用长连接)
+    UpstreamClient m_upstream;
+
+    // Logs the slowest regex rules while profiling (GUI thread) / 性能分析时输出最慢的正则规则 (GUI 线程)
+    QTimer m_regexProfileTimer;
+
+    // Persistent exact-match translation cache (internally locked)
+    // 持久化精确匹配翻译缓存 (内部自带锁)
+    TranslationCache m_cache;
+
+    // Coalesces identical concurrent requests into one upstream call
+    // 将相同的并发请求合并为一次上游调用
+    SingleFlight<QString> m_inflight;
+
+    // Prompt tokens reported by the API, and how many of them hit the provider's prefix cache
+    // API 报告的提示词 Token 数，以及其中命中服务端前缀缓存的数量
+    std::atomic<long long> m_usagePromptTokens{0};
+    std::atomic<long long> m_usageCachedTokens{0};
 
     // Error Retry Messages
     // 错误重试相关函数声明
     
     // Performs one attempt of translation without retry logic
     // 执行单次翻译尝试，不包含重试循环
-    QString performSingleTranslationAttempt(const QString& text, const QString& clientIP);
+    QString performSingleTranslationAttempt(const QString& processedText, const QString& contextKey, int timeoutMs,
+                                            const QSet<QString>& avoidKeys, AttemptStatus* status);
+
+    // Sleep between retries; returns false if the server stopped meanwhile
+    // 重试间隔休眠；期间服务停止则返回 false
+    bool waitUnlessStopped(qint64 ms);
     
     // Checks if the returned string is a valid translation (not an error message or empty)
     // 检查返回的字符串是否为有效的翻译结果（非错误信息或空）
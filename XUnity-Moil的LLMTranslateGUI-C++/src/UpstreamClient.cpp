@@ -0,0 +1,203 @@
+#include "UpstreamClient.h"
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QMetaObject>
+#include <algorithm>
+
+UpstreamClient::UpstreamClient(QObject *parent) : QObject(parent) {
+    m_thread.setObjectName("UpstreamNetwork");
+}
+
+UpstreamClient::~UpstreamClient() {
+    stop();
+}
+
+/**
+ * @brief Starts the network thread and its QNetworkAccessManagers
+ * @brief 启动网络线程及其 QNetworkAccessManager
+ */
+void UpstreamClient::start(const QUrl& warmUrl, bool http2, int connections, int concurrency) {
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    if (!m_lanes.empty()) return;
+
+    m_http2 = http2;
+    // Qt negotiates HTTP/2 only over TLS (ALPN); plain http:// stays on HTTP/1.1
+    // Qt 只在 TLS 上协商 HTTP/2 (ALPN)；普通 http:// 仍使用 HTTP/1.1
+    const bool multiplexed = http2 && warmUrl.scheme() == "https";
+    // HTTP/1.1: each manager opens at most 6 connections per host, more requests queue inside it
+    // HTTP/1.1：每个管理器对每个主机最多 6 条连接，更多的请求会在管理器内部排队
+    int laneCount = multiplexed
+        ? std::max(1, connections)
+        : std::max(1, (concurrency + HTTP1_CONNECTIONS_PER_HOST - 1) / HTTP1_CONNECTIONS_PER_HOST);
+
+    // Create the managers here, then hand them to the network thread before any request is made
+    // 在此创建管理器，并在发出任何请求前移交给网络线程
+    for (int i = 0; i < laneCount; ++i) {
+        auto lane = std::make_shared<Lane>();
+        lane->manager = new QNetworkAccessManager();
+        lane->manager->moveToThread(&m_thread);
+        m_lanes.push_back(lane);
+    }
+    m_thread.start();
+
+    // Pre-open every lane so the first translations do not pay the TCP/TLS handshake
+    // 预先建立每个通道的连接，让最初的翻译不必承担 TCP/TLS 握手开销
+    if (warmUrl.isValid() && !warmUrl.host().isEmpty()) {
+        for (const auto& lane : m_lanes) {
+            QNetworkAccessManager* manager = lane->manager;
+            QMetaObject::invokeMethod(manager, [manager, warmUrl]() {
+                if (warmUrl.scheme() == "https") {
+                    manager->connectToHostEncrypted(warmUrl.host(), quint16(warmUrl.port(443)));
+                } else {
+                    manager->connectToHost(warmUrl.host(), quint16(warmUrl.port(80)));
+                }
+            }, Qt::QueuedConnection);
+        }
+    }
+}
+
+/**
+ * @brief Aborts in-flight requests and stops the network thread
+ * @brief 中止进行中的请求并停止网络线程
+ */
+void UpstreamClient::stop() {
+    std::vector<std::shared_ptr<Lane>> lanes;
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        lanes.swap(m_lanes); // New posts fail fast from now on / 此后的新请求立即失败
+    }
+    if (lanes.empty()) return;
+
+    // Abort on the owning thread; each abort emits finished and fulfils its promise
+    // 在所属线程中止请求；每次中止都会触发 finished 并兑现对应的 promise
+    for (const auto& lane : lanes) {
+        QNetworkAccessManager* manager = lane->manager;
+        QMetaObject::invokeMethod(manager, [manager]() {
+            const auto replies = manager->findChildren<QNetworkReply*>();
+            for (QNetworkReply* reply : replies) reply->abort();
+            manager->deleteLater();
+        }, Qt::BlockingQueuedConnection);
+    }
+
+    m_thread.quit();
+    m_thread.wait();
+}
+
+/**
+ * @brief Submits a POST request to the least busy lane
+ * @brief 将 POST 请求提交到最空闲的通道
+ */
+std::future<UpstreamResponse> UpstreamClient::post(const QNetworkRequest& request, const QByteArray& body, int timeoutMs) {
+    return postStreaming(request, body, timeoutMs, nullptr, nullptr);
+}
+
+/**
+ * @brief Submits a POST request whose body is handed over chunk by chunk
+ * @brief 提交 POST 请求，响应体逐块交给回调
+ */
+std::future<UpstreamResponse> UpstreamClient::postStreaming(const QNetworkRequest& request, const QByteArray& body, int timeoutMs,
+                                                            DataCallback onData, FinishedCallback onFinished) {
+    auto promise = std::make_shared<std::promise<UpstreamResponse>>();
+    std::future<UpstreamResponse> future = promise->get_future();
+
+    std::unique_lock<std::mutex> lock(m_stateMutex);
+    if (m_lanes.empty()) {
+        lock.unlock();
+        UpstreamResponse stopped;
+        stopped.error = QNetworkReply::OperationCanceledError;
+        stopped.errorString = "Upstream client is not running";
+        // Finish like an aborted request so the caller releases its key and ends its stream
+        // 与被中止的请求一样结束，调用方据此归还密钥并结束流
+        if (onFinished) onFinished(stopped);
+        promise->set_value(stopped);
+        return future;
+    }
+
+    // Pick the lane with the fewest concurrent streams / 选择当前并发流最少的通道
+    std::shared_ptr<Lane> lane = m_lanes.front();
+    for (const auto& candidate : m_lanes) {
+        if (candidate->inFlight.load() < lane->inFlight.load()) lane = candidate;
+    }
+    int inFlight = ++lane->inFlight;
+    int peak = lane->peakInFlight.load();
+    while (inFlight > peak && !lane->peakInFlight.compare_exchange_weak(peak, inFlight)) {}
+
+    QNetworkRequest http2Request(request);
+    http2Request.setAttribute(QNetworkRequest::Http2AllowedAttribute, m_http2);
+
+    QNetworkAccessManager* manager = lane->manager;
+    QMetaObject::invokeMethod(manager, [manager, lane, http2Request, body, timeoutMs, promise, onData, onFinished]() {
+        QNetworkReply* reply = manager->post(http2Request, body);
+
+        // Our own timer, parented to the reply so it dies with it / 本地超时计时器，以 reply 为父对象随其销毁
+        auto timedOut = std::make_shared<bool>(false);
+        QTimer* timer = new QTimer(reply);
+        timer->setSingleShot(true);
+        QObject::connect(timer, &QTimer::timeout, reply, [reply, timedOut]() {
+            *timedOut = true;
+            reply->abort();
+        });
+        // The first run bounds the wait for a free connection; once the request is on the wire the
+        // timeout starts over, so time queued inside the manager is not charged to the endpoint
+        // 第一轮计时限制等待空闲连接的时间；请求真正发出后重新计时，在管理器内排队的时间不算到端点头上
+        auto submitted = std::make_shared<QElapsedTimer>();
+        submitted->start();
+        auto queuedMs = std::make_shared<qint64>(-1);
+        QObject::connect(reply, &QNetworkReply::requestSent, timer, [timer, submitted, queuedMs, timeoutMs]() {
+            if (*queuedMs >= 0) return; // Emitted once per sent chunk / 每发出一块都会触发
+            *queuedMs = submitted->elapsed();
+            timer->start(timeoutMs);
+        });
+        timer->start(timeoutMs);
+
+        if (onData) {
+            QObject::connect(reply, &QNetworkReply::readyRead, reply, [reply, onData]() {
+                int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+                if (status >= 400) return; // Keep error bodies for finished / 错误响应体留给 finished 处理
+                onData(reply->readAll());
+            });
+        }
+
+        QObject::connect(reply, &QNetworkReply::finished, reply,
+                         [reply, lane, promise, timedOut, submitted, queuedMs, onData, onFinished]() {
+            UpstreamResponse response;
+            response.error = reply->error();
+            response.httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            response.errorString = reply->errorString();
+            response.body = reply->readAll();
+            // Deliver bytes that arrived together with the finished signal / 交付与 finished 同时到达的数据
+            if (onData && response.httpStatus < 400 && !response.body.isEmpty()) {
+                onData(response.body);
+                response.body.clear();
+            }
+            response.headers = reply->rawHeaderPairs();
+            response.timedOut = *timedOut;
+            response.queuedMs = *queuedMs >= 0 ? *queuedMs : submitted->elapsed();
+            response.http2 = reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool();
+
+            --lane->inFlight;
+            ++lane->requests;
+            if (response.http2) ++lane->http2Requests;
+
+            if (onFinished) onFinished(response);
+            promise->set_value(response);
+            reply->deleteLater();
+        });
+    }, Qt::QueuedConnection);
+
+    return future;
+}
+
+std::vector<UpstreamClient::LaneStats> UpstreamClient::laneStats() const {
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    std::vector<LaneStats> stats;
+    for (const auto& lane : m_lanes) {
+        LaneStats s;
+        s.inFlight = lane->inFlight.load();
+        s.peakInFlight = lane->peakInFlight.load();
+        s.requests = lane->requests.load();
+        s.http2Requests = lane->http2Requests.load();
+        stats.push_back(s);
+    }
+    return stats;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <QObject>
+#include <QThread>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <future>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <functional>
+
+/**
+ * @brief Result of one upstream HTTP call
+ * @brief 一次上游 HTTP 调用的结果
+ */
+struct UpstreamResponse {
+    QNetworkReply::NetworkError error = QNetworkReply::NoError;
+    int httpStatus = 0;         // 0 if no HTTP response was received / 未收到 HTTP 响应时为 0
+    QString errorString;
+    QByteArray body;
+    QList<QNetworkReply::RawHeaderPair> headers;
+    bool timedOut = false;      // Aborted by our own timeout / 被本地超时中止
+    bool http2 = false;         // Served over HTTP/2 / 是否通过 HTTP/2 完成
+    qint64 queuedMs = 0;        // Time spent waiting for a connection before sending / 发出前等待连接的时间
+};
+
+/**
+ * @brief Shared Upstream HTTP Client
+ * @brief 共享的上游 HTTP 客户端
+ *
+ * Owns long-lived QNetworkAccessManagers on a dedicated network thread, so TCP/TLS
+ * connections to the API are pooled and kept alive across requests. Worker threads
+ * submit requests from any thread and block on the returned future.
+ * 在专用网络线程上持有长期存活的 QNetworkAccessManager，使到 API 的 TCP/TLS
+ * 连接在请求之间复用 (连接池 + keep-alive)。工作线程可从任意线程提交请求，并在返回的 future 上等待。
+ *
+ * With HTTP/2 each manager ("lane") keeps a single multiplexed connection per host,
+ * so the number of lanes is the number of upstream connections. Over HTTP/1.1 (HTTP/2 off,
+ * or a plain http:// endpoint such as a local LLM) Qt opens at most 6 connections per host
+ * and manager, so there are enough lanes for the expected concurrency.
+ * 启用 HTTP/2 时，每个管理器 ("通道") 对每个主机只保持一条多路复用连接，
+ * 因此通道数即上游连接数。使用 HTTP/1.1 时 (关闭 HTTP/2，或本地 LLM 等 http:// 端点)，
+ * Qt 每个管理器对每个主机最多开 6 条连接，因此按预期并发数创建足够的通道。
+ */
+class UpstreamClient : public QObject {
+    Q_OBJECT
+public:
+    // Per-connection counters / 每条连接的统计
+    struct LaneStats {
+        int inFlight = 0;       // Concurrent streams right now / 当前并发流数
+        int peakInFlight = 0;   // Highest concurrency seen / 观察到的最高并发
+        quint64 requests = 0;   // Completed requests / 已完成的请求数
+        quint64 http2Requests = 0; // Of which served over HTTP/2 / 其中通过 HTTP/2 完成的
+    };
+
+    explicit UpstreamClient(QObject *parent = nullptr);
+    ~UpstreamClient();
+
+    // Connections Qt opens per host and manager over HTTP/1.1 / HTTP/1.1 下 Qt 每个管理器对每个主机的连接数
+    static constexpr int HTTP1_CONNECTIONS_PER_HOST = 6;
+
+    // Start the network thread; optionally pre-open the lanes to warmUrl. HTTP/2 uses `connections`
+    // lanes, HTTP/1.1 enough lanes for `concurrency` simultaneous requests.
+    // 启动网络线程；可选地预先建立到 warmUrl 的连接。HTTP/2 使用 `connections` 个通道，
+    // HTTP/1.1 按 `concurrency` 个同时进行的请求创建足够的通道。
+    void start(const QUrl& warmUrl = QUrl(), bool http2 = true, int connections = 1, int concurrency = 1);
+
+    // Abort in-flight requests and stop the network thread
+    // 中止进行中的请求并停止网络线程
+    void stop();
+
+    // Submit a POST from any thread. The reply is aborted timeoutMs after the request was sent
+    // (waiting for a free connection is bounded by timeoutMs as well).
+    // 从任意线程提交 POST 请求，请求发出 timeoutMs 后中止 (等待空闲连接的时间同样以 timeoutMs 为上限)。
+    std::future<UpstreamResponse> post(const QNetworkRequest& request, const QByteArray& body, int timeoutMs);
+
+    // Streaming variant: onData receives body bytes as they arrive and onFinished runs before
+    // the future is fulfilled. Both run on the network thread. Error bodies (HTTP >= 400) are
+    // not streamed and stay in UpstreamResponse::body.
+    // 流式版本：onData 在数据到达时接收响应体字节，onFinished 在 future 兑现前执行，二者都在网络线程上运行。
+    // 错误响应体 (HTTP >= 400) 不走流式回调，保留在 UpstreamResponse::body 中。
+    using DataCallback = std::function<void(const QByteArray&)>;
+    using FinishedCallback = std::function<void(const UpstreamResponse&)>;
+    std::future<UpstreamResponse> postStreaming(const QNetworkRequest& request, const QByteArray& body, int timeoutMs,
+                                                DataCallback onData, FinishedCallback onFinished);
+
+    // Snapshot of per-lane counters / 各通道统计快照
+    std::vector<LaneStats> laneStats() const;
+
+private:
+    struct Lane {
+        QNetworkAccessManager* manager = nullptr; // Lives in m_thread / 归属于 m_thread
+        std::atomic<int> inFlight{0};
+        std::atomic<int> peakInFlight{0};
+        std::atomic<quint64> requests{0};
+        std::atomic<quint64> http2Requests{0};
+    };
+
+    QThread m_thread;
+    std::vector<std::shared_ptr<Lane>> m_lanes;
+    bool m_http2 = true;
+    mutable std::mutex m_stateMutex; // Protects m_lanes / 保护 m_lanes
+};
@@ -0,0 +1,88 @@
+/**
+ * @brief BatchReply::split table test
+ * @brief BatchReply::split 表驱动测试
+ *
+ * Feeds numbered replies (in order, shuffled, with full-width punctuation, with chatter, with
+ * missing, duplicate, out-of-range or unnumbered lines) to BatchReply::split and checks whether
+ * it accepts them and, if so, the per-line translations. Exits with 1 on any failure.
+ * 将各种编号回复 (顺序、乱序、全角标点、带多余说明、缺行、重复、越界或无编号行) 交给
+ * BatchReply::split，检查其是否接受以及接受时拆分出的逐行译文。任一失败即返回 1。
+ */
+#include "BatchReply.h"
+#include <QString>
+#include <QStringList>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+int g_failures = 0;
+
+struct Case {
+    const char* name;
+    const char16_t* reply;
+    int expected;
+    bool ok;
+    std::vector<const char16_t*> lines; // Expected translations when ok / 接受时应得到的译文
+};
+
+void runCase(const Case& c) {
+    QStringList out{QStringLiteral("untouched")};
+    const bool ok = BatchReply::split(QString::fromUtf16(c.reply), c.expected, out);
+    if (ok != c.ok) {
+        ++g_failures;
+        std::printf("FAIL: %s: split returned %s\n", c.name, ok ? "true" : "false");
+        return;
+    }
+    if (!ok) {
+        // A rejected reply leaves out alone / 被拒绝的回复不修改 out
+        if (out != QStringList{QStringLiteral("untouched")}) {
+            ++g_failures;
+            std::printf("FAIL: %s: output changed on failure\n", c.name);
+        }
+        return;
+    }
+    QStringList expected;
+    for (const char16_t* line : c.lines) expected << QString::fromUtf16(line);
+    if (out != expected) {
+        ++g_failures;
+        std::printf("FAIL: %s: got [%s]\n", c.name, out.join(QStringLiteral(" | ")).toUtf8().constData());
+    }
+}
+
+} // namespace
+
+int main() {
+    const Case cases[] = {
+        {"in order", u"1. 你好\n2. 世界\n3. 再见", 3, true, {u"你好", u"世界", u"再见"}},
+        {"shuffled", u"2. 世界\n3. 再见\n1. 你好", 3, true, {u"你好", u"世界", u"再见"}},
+        {"single", u"1. 只有一行", 1, true, {u"只有一行"}},
+        {"full-width and other separators", u"1．甲\n2、乙\n3：丙\n4）丁\n5)戊\n6]己\n7:庚", 7, true,
+         {u"甲", u"乙", u"丙", u"丁", u"戊", u"己", u"庚"}},
+        {"spaces around number and text", u"  1 .   甲  \n\t2.乙\t", 2, true, {u"甲", u"乙"}},
+        {"blank lines and CRLF", u"1. 甲\r\n\r\n\n2. 乙\r\n", 2, true, {u"甲", u"乙"}},
+        {"chatter before the list", u"Here are the translations:\n1. 甲\n2. 乙", 2, true, {u"甲", u"乙"}},
+        {"empty translation kept", u"1.\n2. 乙", 2, true, {u"", u"乙"}},
+        {"two-digit numbers", u"1. a\n2. b\n3. c\n4. d\n5. e\n6. f\n7. g\n8. h\n9. i\n10. j\n11. k", 11, true,
+         {u"a", u"b", u"c", u"d", u"e", u"f", u"g", u"h", u"i", u"j", u"k"}},
+        {"number inside the text", u"1. 第2章\n2. 3. 开始", 2, true, {u"第2章", u"3. 开始"}},
+
+        {"missing line", u"1. 甲\n3. 丙", 3, false, {}},
+        {"duplicate number", u"1. 甲\n1. 乙", 2, false, {}},
+        {"number zero", u"0. 甲\n1. 乙", 2, false, {}},
+        {"number out of range", u"1. 甲\n2. 乙\n3. 丙", 2, false, {}},
+        {"unnumbered line inside the list", u"1. 甲\n这是第一行的续行\n2. 乙", 2, false, {}},
+        {"chatter after the list", u"1. 甲\n2. 乙\nHope this helps!", 2, false, {}},
+        {"no separator", u"1 甲\n2 乙", 2, false, {}},
+        {"empty reply", u"", 2, false, {}},
+        {"nothing expected", u"1. 甲", 0, false, {}},
+    };
+    for (const Case& c : cases) runCase(c);
+
+    if (g_failures) {
+        std::printf("%d failure(s)\n", g_failures);
+        return 1;
+    }
+    std::printf("BatchReply: all cases passed\n");
+    return 0;
+}
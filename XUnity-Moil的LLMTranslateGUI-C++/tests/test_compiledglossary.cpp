@@ -0,0 +1,213 @@
+/**
+ * @brief CompiledGlossary sidecar validation test
+ * @brief CompiledGlossary 伴随文件校验测试
+ *
+ * Compiles a small glossary, saves its sidecar, then damages one field at a time (header
+ * sections, entries, the nextSame chains, automaton states and edges) and opens it again.
+ * Every damaged sidecar must be rejected and the glossary rebuilt from the .txt, with the
+ * same terms and matches as before. The undamaged sidecar must be mapped as is.
+ * Exits with 1 on any failure.
+ * 编译一个小术语表并保存伴随文件，然后每次破坏其中一个字段 (头部各段、条目、nextSame 链、
+ * 自动机状态与边) 并重新打开。每个损坏的伴随文件都必须被拒绝，并从 .txt 重建出与之前相同的
+ * 术语与匹配结果；未损坏的伴随文件必须被直接映射。任一失败即返回 1。
+ */
+#include "CompiledGlossary.h"
+#include "AhoCorasick.h"
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QTemporaryDir>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+namespace {
+
+int g_failures = 0;
+
+void fail(const char* name, const char* what) {
+    ++g_failures;
+    std::printf("FAIL: %s: %s\n", name, what);
+}
+
+// On-disk layout of format version 1 (CompiledGlossary.cpp) / 格式版本 1 的磁盘布局 (见 CompiledGlossary.cpp)
+struct Header {
+    char magic[8];
+    quint32 version;
+    quint32 termCount;
+    qint64 sourceSize;
+    qint64 sourceMtime;
+    qint64 entriesOffset;
+    qint64 stringsOffset;
+    qint64 stringUnits;
+    qint64 statesOffset;
+    qint64 stateCount;
+    qint64 edgesOffset;
+    qint64 edgeCount;
+    qint64 nextSameOffset;
+    qint64 totalSize;
+};
+
+struct Entry {
+    quint32 keyOffset;
+    quint32 keyLength;
+    quint32 valueOffset;
+    quint32 valueLength;
+};
+
+// Typed access to a copy of the sidecar / 对伴随文件副本的类型化访问
+struct Image {
+    QByteArray bytes;
+
+    Header& header() { return *reinterpret_cast<Header*>(bytes.data()); }
+    template <typename T> T* at(qint64 offset) { return reinterpret_cast<T*>(bytes.data() + offset); }
+    Entry* entries() { return at<Entry>(header().entriesOffset); }
+    qint32* nextSame() { return at<qint32>(header().nextSameOffset); }
+    AhoCorasick::FlatState* states() { return at<AhoCorasick::FlatState>(header().statesOffset); }
+    AhoCorasick::FlatEdge* edges() { return at<AhoCorasick::FlatEdge>(header().edgesOffset); }
+
+    // First state at the given depth, -1 if none / 第一个位于该深度的状态，没有则为 -1
+    qint64 stateAtDepth(qint32 depth) {
+        for (qint64 s = 0; s < header().stateCount; ++s) {
+            if (states()[s].depth == depth) return s;
+        }
+        return -1;
+    }
+};
+
+// "王" is a suffix of "魔王", so the automaton has dictionary links as well as failure links
+// "王" 是 "魔王" 的后缀，因此自动机中既有失败链接也有字典链接
+const char* const kGlossary =
+    "勇者=Hero\n"
+    "魔王=Demon King\n"
+    "魔王城=Demon Castle\n"
+    "王=King\n"
+    "Alice=爱丽丝\n"
+    "Bob=鲍勃\n";
+constexpr int kTermCount = 6;
+
+bool writeFile(const QString& path, const QByteArray& data) {
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly | QIODevice::Truncate) && file.write(data) == data.size();
+}
+
+// The glossary answers as compiled from kGlossary / 术语表的查询结果与由 kGlossary 编译的一致
+bool looksRight(const CompiledGlossary& glossary) {
+    if (glossary.termCount() != kTermCount) return false;
+    int demon = glossary.indexOf(u"魔王");
+    if (demon < 0 || glossary.value(demon) != QStringView(u"Demon King")) return false;
+    if (glossary.indexOf(u"魔") >= 0) return false;
+    // "魔王城" contains 魔王城, 魔王 and 王 / "魔王城" 包含 魔王城、魔王 与 王
+    return glossary.findAll(QStringLiteral("魔王城的勇者Alice")).size() == 5;
+}
+
+struct Damage {
+    const char* name;
+    std::function<void(Image&)> apply;
+};
+
+} // namespace
+
+int main() {
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        std::printf("FAIL: no temporary directory\n");
+        return 1;
+    }
+    const QString source = dir.filePath("glossary.txt");
+    const QString sidecar = CompiledGlossary::sidecarPath(source);
+    if (!writeFile(source, QByteArray(kGlossary))) {
+        std::printf("FAIL: cannot write %s\n", source.toUtf8().constData());
+        return 1;
+    }
+
+    // Compile once and save the sidecar / 编译一次并保存伴随文件
+    {
+        CompiledGlossary glossary;
+        if (!glossary.open(source) || glossary.loadedFromCache() || !looksRight(glossary)) fail("compile", "wrong result");
+        if (!glossary.saveSidecar()) fail("compile", "sidecar not saved");
+    }
+    QFile saved(sidecar);
+    if (!saved.open(QIODevice::ReadOnly)) {
+        std::printf("FAIL: sidecar missing\n");
+        return 1;
+    }
+    const QByteArray good = saved.readAll();
+    saved.close();
+
+    // The undamaged sidecar is mapped / 未损坏的伴随文件被直接映射
+    {
+        CompiledGlossary glossary;
+        if (!glossary.open(source) || !glossary.loadedFromCache() || !looksRight(glossary)) {
+            fail("undamaged", "not mapped as is");
+        }
+    }
+
+    const std::vector<Damage> damages = {
+        // Header / 头部
+        {"wrong magic", [](Image& im) { im.header().magic[0] = 'Y'; }},
+        {"wrong version", [](Image& im) { im.header().version += 1; }},
+        {"truncated", [](Image& im) { im.bytes.chop(8); }},
+        {"stale source", [](Image& im) { im.header().sourceMtime += 1; }},
+        {"term count overflow", [](Image& im) { im.header().termCount = 0x80000000u; }},
+        {"no states", [](Image& im) { im.header().stateCount = 0; }},
+        {"strings past the end", [](Image& im) { im.header().stringsOffset = im.header().totalSize; }},
+        {"misaligned entries", [](Image& im) { im.header().entriesOffset += 4; }},
+        {"edge count too large", [](Image& im) { im.header().edgeCount = im.header().totalSize; }},
+        // Entries / 条目
+        {"key past the pool", [](Image& im) { im.entries()[0].keyOffset = quint32(im.header().stringUnits); }},
+        {"value past the pool",
+         [](Image& im) { im.entries()[kTermCount - 1].valueLength = quint32(im.header().stringUnits) + 1; }},
+        // nextSame chains / nextSame 链
+        {"nextSame loop", [](Image& im) { im.nextSame()[0] = 0; }},
+        {"nextSame forward", [](Image& im) { im.nextSame()[1] = kTermCount - 1; }},
+        {"nextSame below -1", [](Image& im) { im.nextSame()[1] = -2; }},
+        // States / 状态
+        {"root depth", [](Image& im) { im.states()[0].depth = 1; }},
+        {"root fail", [](Image& im) { im.states()[0].fail = 1; }},
+        {"edges past the table", [](Image& im) { im.states()[0].edgeCount = quint32(im.header().edgeCount) + 1; }},
+        {"output out of range", [](Image& im) { im.states()[im.stateAtDepth(1)].output = kTermCount; }},
+        {"output below -1", [](Image& im) { im.states()[im.stateAtDepth(1)].output = -2; }},
+        {"fail out of range", [](Image& im) { im.states()[im.stateAtDepth(1)].fail = qint32(im.header().stateCount); }},
+        {"fail to itself", [](Image& im) {
+             qint64 s = im.stateAtDepth(2);
+             im.states()[s].fail = qint32(s);
+         }},
+        {"fail deeper", [](Image& im) { im.states()[im.stateAtDepth(1)].fail = qint32(im.stateAtDepth(2)); }},
+        {"dictLink out of range",
+         [](Image& im) { im.states()[im.stateAtDepth(2)].dictLink = qint32(im.header().stateCount); }},
+        {"dictLink to itself", [](Image& im) {
+             qint64 s = im.stateAtDepth(2);
+             im.states()[s].dictLink = qint32(s);
+         }},
+        // Edges / 边
+        {"edge to root", [](Image& im) { im.edges()[0].target = 0; }},
+        {"edge out of range", [](Image& im) { im.edges()[0].target = qint32(im.header().stateCount); }},
+        {"edge skips a level", [](Image& im) {
+             // Root edges lead to depth 1; point one at depth 2 / 根节点的边通向深度 1；改为指向深度 2
+             im.edges()[im.states()[0].edgeStart].target = qint32(im.stateAtDepth(2));
+         }},
+    };
+
+    for (const Damage& damage : damages) {
+        Image image{good};
+        damage.apply(image);
+        if (!writeFile(sidecar, image.bytes)) {
+            fail(damage.name, "cannot write the damaged sidecar");
+            continue;
+        }
+        CompiledGlossary glossary;
+        if (!glossary.open(source)) fail(damage.name, "glossary not rebuilt");
+        else if (glossary.loadedFromCache()) fail(damage.name, "damaged sidecar was accepted");
+        else if (!glossary.needsSave()) fail(damage.name, "rebuilt image not marked for saving");
+        else if (!looksRight(glossary)) fail(damage.name, "rebuilt glossary gives wrong results");
+    }
+
+    if (g_failures) {
+        std::printf("%d failure(s)\n", g_failures);
+        return 1;
+    }
+    std::printf("CompiledGlossary: %d damaged sidecars rejected\n", int(damages.size()));
+    return 0;
+}
@@ -0,0 +1,186 @@
+/**
+ * @brief JsonWriter round-trip test
+ * @brief JsonWriter 往返测试
+ *
+ * Writes random UTF-16 strings (ASCII control characters, quotes, backslashes, BMP text,
+ * surrogate pairs and unpaired surrogates) with JsonWriter, parses the result back with
+ * nlohmann::json and compares it with the expected UTF-8 text. Unpaired surrogates must
+ * come back as U+FFFD. Exits with 1 on the first failure.
+ * 使用 JsonWriter 写入随机 UTF-16 字符串 (ASCII 控制字符、引号、反斜杠、BMP 文字、代理对与
+ * 不成对的代理项)，再用 nlohmann::json 解析并与预期的 UTF-8 文本比较。不成对的代理项
+ * 必须还原为 U+FFFD。首次失败即返回 1。
+ */
+#include "JsonWriter.h"
+#include "json.hpp"
+#include <QByteArray>
+#include <QString>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+
+namespace {
+
+using json = nlohmann::json;
+
+constexpr int STRING_COUNT = 20000;
+constexpr int MAX_PIECES = 40;
+
+int g_failures = 0;
+
+void check(bool ok, const char* what, const QByteArray& body) {
+    if (ok) return;
+    ++g_failures;
+    std::printf("FAIL: %s\n  body: %s\n", what, body.constData());
+}
+
+// A random string and the text it must decode to / 随机字符串及其应解码出的文本
+struct Sample {
+    QString input;
+    QString expected;
+};
+
+Sample randomSample(std::mt19937& rng) {
+    std::uniform_int_distribution<int> kind(0, 6);
+    std::uniform_int_distribution<int> pieces(0, MAX_PIECES);
+    Sample s;
+    for (int n = pieces(rng); n > 0; --n) {
+        switch (kind(rng)) {
+        case 0: { // ASCII control character / ASCII 控制字符
+            QChar c(char16_t(std::uniform_int_distribution<int>(0, 0x1F)(rng)));
+            s.input += c;
+            s.expected += c;
+            break;
+        }
+        case 1: { // Characters JSON escapes / JSON 需要转义的字符
+            QChar c = std::uniform_int_distribution<int>(0, 1)(rng) ? QChar('"') : QChar('\\');
+            s.input += c;
+            s.expected += c;
+            break;
+        }
+        case 2: { // Printable ASCII / 可打印 ASCII
+            QChar c(char16_t(std::uniform_int_distribution<int>(0x20, 0x7E)(rng)));
+            s.input += c;
+            s.expected += c;
+            break;
+        }
+        case 3: { // Two- and three-byte UTF-8 (outside the surrogate range) / 两字节与三字节 UTF-8 (代理项范围之外)
+            int u = std::uniform_int_distribution<int>(0x80, 0xFFFF - 0x800)(rng);
+            if (u >= 0xD800) u += 0x800;
+            s.input += QChar(char16_t(u));
+            s.expected += QChar(char16_t(u));
+            break;
+        }
+        case 4: { // Surrogate pair / 代理对
+            int cp = std::uniform_int_distribution<int>(0x10000, 0x10FFFF)(rng) - 0x10000;
+            QString pair;
+            pair += QChar(char16_t(0xD800 + (cp >> 10)));
+            pair += QChar(char16_t(0xDC00 + (cp & 0x3FF)));
+            s.input += pair;
+            s.expected += pair;
+            break;
+        }
+        case 5: { // Unpaired high surrogate, followed by ASCII so it cannot pair up
+                  // 不成对的高代理项，后接 ASCII 以免与后续内容组成代理对
+            QChar c(char16_t(std::uniform_int_distribution<int>(0xD800, 0xDBFF)(rng)));
+            s.input += c;
+            s.input += QChar('x');
+            s.expected += QChar(char16_t(0xFFFD));
+            s.expected += QChar('x');
+            break;
+        }
+        default: { // Unpaired low surrogate / 不成对的低代理项
+            QChar c(char16_t(std::uniform_int_distribution<int>(0xDC00, 0xDFFF)(rng)));
+            s.input += c;
+            s.expected += QChar(char16_t(0xFFFD));
+            break;
+        }
+        }
+    }
+    return s;
+}
+
+void testStrings() {
+    std::mt19937 rng(12345);
+    for (int i = 0; i < STRING_COUNT && g_failures == 0; ++i) {
+        Sample s = randomSample(rng);
+        JsonWriter& writer = JsonWriter::forThread();
+        writer.beginObject();
+        writer.key("content");
+        writer.value(s.input);
+        writer.endObject();
+        const QByteArray body = writer.toByteArray();
+
+        json parsed = json::parse(body.constData(), body.constData() + body.size(), nullptr, false);
+        check(!parsed.is_discarded(), "writer produced invalid JSON", body);
+        if (parsed.is_discarded()) continue;
+        check(parsed["content"].get<std::string>() == s.expected.toStdString(), "string did not round-trip", body);
+    }
+}
+
+// Nesting, separators and scalar values / 嵌套、分隔符与标量值
+void testDocument() {
+    JsonWriter& writer = JsonWriter::forThread();
+    writer.beginObject();
+    writer.key("model");
+    writer.value("m");
+    writer.key("messages");
+    writer.beginArray();
+    for (int i = 0; i < 3; ++i) {
+        writer.beginObject();
+        writer.key("role");
+        writer.value("user");
+        writer.key("content");
+        writer.value(QStringView(u"行 \"1\""));
+        writer.endObject();
+    }
+    writer.endArray();
+    writer.key("empty");
+    writer.beginArray();
+    writer.endArray();
+    writer.key("temperature");
+    writer.value(0.7);
+    writer.key("nan");
+    writer.value(std::nan(""));
+    writer.key("n");
+    writer.value(-42);
+    writer.key("stream");
+    writer.value(true);
+    writer.endObject();
+    const QByteArray body = writer.toByteArray();
+
+    json expected = {
+        {"model", "m"},
+        {"messages", json::array()},
+        {"empty", json::array()},
+        {"temperature", 0.7},
+        {"nan", nullptr},
+        {"n", -42},
+        {"stream", true},
+    };
+    for (int i = 0; i < 3; ++i) {
+        expected["messages"].push_back({{"role", "user"}, {"content", "行 \"1\""}});
+    }
+    json parsed = json::parse(body.constData(), body.constData() + body.size(), nullptr, false);
+    check(parsed == expected, "document did not round-trip", body);
+
+    // forThread() hands out a cleared writer / forThread() 返回已清空的写入器
+    JsonWriter& again = JsonWriter::forThread();
+    again.beginArray();
+    again.value(false);
+    again.endArray();
+    check(again.toByteArray() == QByteArray("[false]"), "writer was not cleared", again.toByteArray());
+}
+
+} // namespace
+
+int main() {
+    testDocument();
+    testStrings();
+    if (g_failures) {
+        std::printf("%d failure(s)\n", g_failures);
+        return 1;
+    }
+    std::printf("JsonWriter: all round-trips passed\n");
+    return 0;
+}
@@ -0,0 +1,203 @@
+/**
+ * @brief Regex prefilter test
+ * @brief 正则预过滤测试
+ *
+ * 1. Table of patterns and the literals RegexPass::requiredLiterals must derive from them
+ *    (quantifiers, groups, classes, escapes, alternation, {n,m}), or that it must give up.
+ * 2. Random texts built from matching and near-miss fragments are run through RegexPipeline
+ *    (with the literal prefilter) and through the same passes applied one by one without it;
+ *    the outputs must be identical. With rules not joined, the passes must also equal
+ *    QString::replace applied rule by rule.
+ * Exits with 1 on any failure.
+ * 1. 模式表，以及 RegexPass::requiredLiterals 应从中推导出的字面量 (量词、分组、字符类、转义、
+ *    分支、{n,m})，或应当放弃推导的情况。
+ * 2. 由匹配片段与近似片段随机拼成的文本分别经过 RegexPipeline (带字面量预过滤) 与不带预过滤
+ *    逐个执行的相同阶段，输出必须完全一致。规则不合并时，还必须与逐条执行 QString::replace 的结果一致。
+ * 任一失败即返回 1。
+ */
+#include "RegexManager.h"
+#include "RegexPass.h"
+#include <QString>
+#include <QStringList>
+#include <QRegularExpression>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr int TEXT_COUNT = 5000;
+constexpr int MAX_FRAGMENTS = 8;
+
+int g_failures = 0;
+
+void fail(const QString& message) {
+    ++g_failures;
+    std::printf("FAIL: %s\n", message.toUtf8().constData());
+}
+
+struct LiteralCase {
+    const char* pattern;
+    bool ok;
+    QStringList literals;
+};
+
+void testLiterals() {
+    const LiteralCase cases[] = {
+        // Plain text / 纯文本
+        {R"(abc)", true, {"abc"}},
+        {R"(^abc$)", true, {"abc"}},
+        {R"(\bword\b)", true, {"word"}},
+        {R"((?i)Hello)", true, {"Hello"}},
+        // Quantifiers end a run; a repeated character stays only if it is required
+        // 量词会结束连续字面量；被重复的字符仅在必然出现时保留
+        {R"(a+bc)", true, {"bc"}},
+        {R"(ab*c)", true, {"a"}},
+        {R"(colou?r)", true, {"colo"}},
+        {R"(ab+?c)", true, {"ab"}},
+        {R"(ab*+c)", true, {"a"}},
+        {R"(a*)", false, {}},
+        {R"(.)", false, {}},
+        {R"()", false, {}},
+        // Counted repetition / 计数重复
+        {R"(x{3})", true, {"x"}},
+        {R"(ab{2}c)", true, {"ab"}},
+        {R"(ab{2,}c)", true, {"ab"}},
+        {R"(x{2,3}yz)", true, {"yz"}},
+        {R"(x{0,3})", false, {}},
+        {R"(ab{,2}c)", true, {"a"}},    // {0,2} in newer PCRE2 / 较新的 PCRE2 中等于 {0,2}
+        {R"(a{b)", true, {"a{b"}},      // Literal brace / 字面量花括号
+        {R"(a{,}b)", true, {"a{,}b"}},
+        {R"(a{}bc)", true, {"a{}bc"}},
+        // Groups are skipped as a whole / 分组整体跳过
+        {R"((foo)bar)", true, {"bar"}},
+        {R"((foo|bar)baz)", true, {"baz"}},
+        {R"((?:ab)+cd)", true, {"cd"}},
+        // Character classes / 字符类
+        {R"([abc]def)", true, {"def"}},
+        {R"([]a]xyz)", true, {"xyz"}},
+        {R"([^]x]yz)", true, {"yz"}},
+        {R"([[:alpha:]]+end)", true, {"end"}},
+        {R"(<color=#[0-9a-f]{6}>)", true, {"<color=#"}},
+        // Escapes / 转义
+        {R"(\d+abc)", true, {"abc"}},
+        {R"(\x41BC)", true, {"BC"}},
+        {R"(\x{263A}ok)", true, {"ok"}},
+        {R"(\p{L}+name)", true, {"name"}},
+        {R"(\pLname)", true, {"name"}},
+        {R"(\k<n>xy)", true, {"xy"}},
+        {R"(a\.b)", true, {"a.b"}},
+        {R"(\[tag\])", true, {"[tag]"}},
+        {R"(\\path)", true, {"\\path"}},
+        {R"(a\|b)", true, {"a|b"}},
+        // Alternation: one literal per top-level branch, none if any branch has none
+        // 分支：每个顶层分支一个字面量，任一分支没有字面量则放弃
+        {R"(foo|bar)", true, {"foo", "bar"}},
+        {R"([|]ab|cd)", true, {"ab", "cd"}},
+        {R"(foo|.*)", false, {}},
+        {R"((a|b)|cd)", false, {}},
+        // Quoting and extended mode are not parsed / 不解析引用与扩展模式
+        {R"(\Qabc\E)", false, {}},
+        {R"((?x)abc)", false, {}},
+    };
+
+    for (const LiteralCase& c : cases) {
+        QStringList literals{QStringLiteral("stale")};
+        const bool ok = RegexPass::requiredLiterals(QString::fromUtf8(c.pattern), literals);
+        const QStringList expected = c.ok ? c.literals : QStringList();
+        if (ok != c.ok || literals != expected) {
+            fail(QString("requiredLiterals(%1) = %2 [%3], expected %4 [%5]")
+                     .arg(QString::fromUtf8(c.pattern))
+                     .arg(ok ? "true" : "false")
+                     .arg(literals.join(", "))
+                     .arg(c.ok ? "true" : "false")
+                     .arg(expected.join(", ")));
+        }
+    }
+}
+
+QList<RegexRule> makeRules() {
+    const std::vector<std::pair<const char*, const char*>> table = {
+        {R"(<color=#[0-9a-fA-F]{6}>)", ""},
+        {R"(</color>)", ""},
+        {R"((?i)hello)", "Hi"},
+        {R"(\[(\w+)\])", "【\\1】"},
+        {R"((\d+)G)", "\\1金币"},
+        {R"(colou?r)", "color"},
+        {R"(foo|bar)", "baz"},
+        {R"(ab{,2}c)", "X"},
+        {R"(Hi(\w)\1)", "Hi~\\1"},     // Backreference: own pass, matches only after "hello" became "Hi"
+                                       // 反向引用：单独成为阶段，仅在 "hello" 变为 "Hi" 之后才能匹配
+        {R"(「(.+?)」)", "“\\1”"},
+        {R"(\s+$)", ""},
+        {R"(\d{3,})", "#"},            // No literal: its pass is never filtered / 无字面量：所在阶段从不过滤
+    };
+    QList<RegexRule> rules;
+    for (const auto& row : table) {
+        rules.append({QRegularExpression(QString::fromUtf8(row.first)), QString::fromUtf8(row.second)});
+    }
+    return rules;
+}
+
+QString randomText(std::mt19937& rng) {
+    static const char* fragments[] = {
+        "<color=#ff00AA>", "<color=#zz0000>", "</color>", "</colour>", "hello", "HELLO", "Hel lo", "zz",
+        "[sword]", "[ ]", "[", "]", "100G", "G", "12345", "colour", "color", "colr", "foo", "bar", "ba",
+        "ac", "abc", "abbc", "abbbc", "ab{,2}c", "「台词」", "「", "」", "你好", " ", "  ", "\n", "Hi", "x",
+    };
+    constexpr int fragmentCount = int(sizeof(fragments) / sizeof(fragments[0]));
+    std::uniform_int_distribution<int> pick(0, fragmentCount - 1);
+    std::uniform_int_distribution<int> length(0, MAX_FRAGMENTS);
+    QString text;
+    for (int n = length(rng); n > 0; --n) text += QString::fromUtf8(fragments[pick(rng)]);
+    return text;
+}
+
+void testPrefilter() {
+    const QList<RegexRule> rules = makeRules();
+    for (bool join : {true, false}) {
+        const RegexPipeline pipeline(rules, !join);
+        const QList<RegexPass> passes = RegexPass::compile(rules, join);
+        std::mt19937 rng(join ? 2024 : 4202);
+        for (int i = 0; i < TEXT_COUNT && g_failures == 0; ++i) {
+            const QString text = randomText(rng);
+
+            QString unfiltered = text;
+            for (const RegexPass& pass : passes) pass.apply(unfiltered);
+            const QString filtered = pipeline.run(text);
+            if (filtered != unfiltered) {
+                fail(QString("prefilter changed the output (join=%1)\n  text: %2\n  with: %3\n  without: %4")
+                         .arg(join ? "true" : "false").arg(text).arg(filtered).arg(unfiltered));
+            }
+
+            if (join) continue;
+            QString replaced = text;
+            for (const RegexRule& rule : rules) replaced.replace(rule.pattern, rule.replacement);
+            if (unfiltered != replaced) {
+                fail(QString("passes differ from QString::replace\n  text: %1\n  passes: %2\n  replace: %3")
+                         .arg(text).arg(unfiltered).arg(replaced));
+            }
+        }
+    }
+
+    // The prefilter must actually skip something, or the comparison above proves nothing
+    // 预过滤必须确实跳过了某些阶段，否则上面的比较没有意义
+    const RegexPipeline counted(rules);
+    counted.run(QStringLiteral("zzz"));
+    quint64 skipped = 0;
+    for (const auto& pass : counted.stats()) skipped += pass.skipped;
+    if (skipped == 0) fail("prefilter skipped no pass on text without any literal");
+}
+
+} // namespace
+
+int main() {
+    testLiterals();
+    testPrefilter();
+    if (g_failures) {
+        std::printf("%d failure(s)\n", g_failures);
+        return 1;
+    }
+    std::printf("RegexPass: all cases passed\n");
+    return 0;
+}